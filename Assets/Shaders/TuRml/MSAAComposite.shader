@@ -0,0 +1,33 @@
+{
+    "Source" : "MSAAComposite.azsl",
+    "DepthStencilState" : 
+    {
+        "Depth" : { "Enable" : false }
+    },
+    "GlobalTargetBlendState" : {
+        "Enable" : true,
+        "BlendSource" : "One",
+        "BlendDest" : "AlphaSourceInverse",
+        "BlendOp" : "Add",
+        "BlendAlphaSource" : "One",
+        "BlendAlphaDest" : "AlphaSourceInverse",
+        "BlendAlphaOp" : "Add"
+    },
+    "RasterState" : {
+        "CullMode" : "None"
+    },
+    "ProgramSettings":
+    {
+      "EntryPoints":
+      [
+        {
+          "name": "MainVS",
+          "type": "Vertex"
+        },
+        {
+          "name": "MainPS",
+          "type": "Fragment"
+        }
+      ]
+    }
+}
\ No newline at end of file
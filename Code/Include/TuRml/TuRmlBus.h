@@ -10,11 +10,42 @@
 
 #include <AzCore/EBus/EBus.h>
 #include <AzCore/Interface/Interface.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzCore/std/string/string.h>
+#include <Atom/RHI.Reflect/Format.h>
+
+namespace Rml
+{
+    class Context;
+    class ElementDocument;
+}
 
 namespace TuRml
 {
+    class TuRmlContextTracker;
     class TuRmlRenderInterface;
 
+    //! How often a context is updated, see TuRmlRequests::SetContextUpdatePolicy.
+    //! A context that isn't updated keeps its last draw list, so it isn't rendered either.
+    struct TuRmlContextUpdatePolicy
+    {
+        enum class Priority
+        {
+            //! Updated once everything else is, sharing r_rmlUpdateBudgetMs with the other low priority contexts
+            Low,
+            Normal,
+            //! Updated before normal priority contexts
+            High,
+        };
+
+        //! Updates per second, 0 updates every tick
+        float updateRate = 0.0f;
+        //! Skip updates while the context shows no document or the window is minimised. Opt-in, a paused context
+        //! doesn't process data model changes or release unloaded documents either.
+        bool pauseWhenHidden = false;
+        Priority priority = Priority::Normal;
+    };
+
     class TuRmlRequests
     {
     public:
@@ -23,6 +54,33 @@ namespace TuRml
         
         //! Get the global render interface instance
         virtual TuRmlRenderInterface* GetRenderInterface() = 0;
+
+        //! Start loading textures in the background so they don't show a placeholder when first used.
+        //! Paths are the ones RmlUi loads textures with, they stay cached until ClearPreloadedTextures.
+        virtual void PreloadTextures(const AZStd::vector<AZStd::string>& texturePaths) = 0;
+
+        //! Preload the images of a document's img elements, e.g. before it is shown.
+        virtual void PreloadDocumentTextures(Rml::ElementDocument* document) = 0;
+
+        //! Drop the references held by PreloadTextures, unused textures are evicted after a while.
+        virtual void ClearPreloadedTextures() = 0;
+
+        //! Render the context again next frame instead of reusing its last draw list.
+        //! Needed for changes TuRml can't see, like a style property set from code that doesn't affect layout.
+        //! nullptr invalidates every context.
+        virtual void InvalidateContext(Rml::Context* context) = 0;
+
+        //! Tracks which contexts changed since they were last rendered
+        virtual TuRmlContextTracker* GetContextTracker() = 0;
+
+        //! Contexts without a policy use the default one, the policy is dropped when the context is destroyed
+        virtual void SetContextUpdatePolicy(Rml::Context* context, const TuRmlContextUpdatePolicy& policy) = 0;
+        virtual TuRmlContextUpdatePolicy GetContextUpdatePolicy(Rml::Context* context) = 0;
+
+        //! Build the pipeline states for drawing contexts straight onto a pipeline color of this format and sample
+        //! count, e.g. from a loading screen, so the first frame showing them doesn't. r_rmlMSAA targets are built
+        //! with a sampleCount above 1. Context render targets are built when TuRml activates.
+        virtual void WarmPipelineStates(AZ::RHI::Format colorFormat, uint16_t sampleCount) = 0;
     };
 
     class TuRmlBusTraits
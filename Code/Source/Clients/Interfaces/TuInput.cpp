@@ -12,6 +12,8 @@
 
 #include <RmlUi/Debugger/Debugger.h>
 
+#include <TuRml/TuRmlBus.h>
+
 using namespace TuRml;
 
 static bool HandleMouseDevice(const AzFramework::InputChannel& inputChannel, Rml::Context* ctx)
@@ -302,6 +304,28 @@ void TuInput::OnDestroy(Rml::TextInputContext* ctx)
     AzFramework::InputTextNotificationBus::Handler::BusDisconnect();
 }
 
+void TuInput::InvalidateForInput(const AzFramework::InputChannel& inputChannel, Rml::Context* ctx)
+{
+    const AzFramework::InputChannelId& channelId = inputChannel.GetInputChannelId();
+    if (channelId == AzFramework::InputDeviceMouse::Movement::X || channelId == AzFramework::InputDeviceMouse::Movement::Y)
+    {
+        return;
+    }
+
+    // The cursor position channel updates every tick, only a moved cursor can change hover state
+    if (channelId == AzFramework::InputDeviceMouse::SystemCursorPosition)
+    {
+        const auto* positionData = inputChannel.GetCustomData<AzFramework::InputChannel::PositionData2D>();
+        if (positionData == nullptr || positionData->m_normalizedPosition == m_lastCursorPosition)
+        {
+            return;
+        }
+        m_lastCursorPosition = positionData->m_normalizedPosition;
+    }
+
+    TuRmlRequestBus::Broadcast(&TuRmlRequests::InvalidateContext, ctx);
+}
+
 bool TuInput::OnInputChannelEventFiltered(const AzFramework::InputChannel& inputChannel)
 {
     const AzFramework::InputChannelId& channelId = inputChannel.GetInputChannelId();
@@ -350,10 +374,12 @@ bool TuInput::OnInputChannelEventFiltered(const AzFramework::InputChannel& input
 
         if (AzFramework::InputDeviceMouse::IsMouseDevice(deviceId))
         {
+            InvalidateForInput(inputChannel, ctx);
             return HandleMouseDevice(inputChannel, ctx);
         }
         if (AzFramework::InputDeviceKeyboard::IsKeyboardDevice(deviceId))
         {
+            InvalidateForInput(inputChannel, ctx);
             if (!HandleKeyboardDevice(inputChannel, ctx))
             {
                 //Not handled
@@ -391,6 +417,7 @@ void TuInput::OnInputTextEvent(const AZStd::string& text, bool& consumed)
         if (ctx == nullptr)
             continue;
 
+        TuRmlRequestBus::Broadcast(&TuRmlRequests::InvalidateContext, ctx);
         consumed = !ctx->ProcessTextInput(text.c_str());
         if (consumed)
         {
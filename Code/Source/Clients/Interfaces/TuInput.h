@@ -8,6 +8,7 @@
 
 #include <AzFramework/Input/Events/InputChannelEventListener.h>
 #include <AzFramework/Input/Buses/Notifications/InputTextNotificationBus.h>
+#include <AzCore/Math/Vector2.h>
 
 #include <RmlUi/Core.h>
 #include <RmlUi/Core/TextInputHandler.h>
@@ -39,6 +40,10 @@ namespace TuRml
            return AzFramework::InputChannelEventListener::GetPriorityUI();
        }
    private:
+        //! Marks the context for rendering again, unless the event can't change anything
+        void InvalidateForInput(const AzFramework::InputChannel& inputChannel, Rml::Context* ctx);
+
         Rml::TextInputContext* m_activeTxtContext = nullptr;
+        AZ::Vector2 m_lastCursorPosition = AZ::Vector2(-1.0f);
    };
 }
@@ -0,0 +1,179 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#include "TuRmlContextScheduler.h"
+#include "../RmlBudget.h"
+
+#include <AzCore/Console/IConsole.h>
+#include <AzCore/std/chrono/chrono.h>
+#include <AzCore/std/sort.h>
+
+#include <RmlUi/Core/Context.h>
+#include <RmlUi/Core/Core.h>
+#include <RmlUi/Core/ElementDocument.h>
+#include <RmlUi/Core/SystemInterface.h>
+
+namespace TuRml
+{
+    AZ_CVAR(float, r_rmlUpdateBudgetMs, 2.0f, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Milliseconds per tick low priority TuRml contexts may spend updating, due ones past it wait a tick");
+
+    void TuRmlContextScheduler::SetPolicy(Rml::Context* context, const TuRmlContextUpdatePolicy& policy)
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+        m_contexts[context].policy = policy;
+    }
+
+    TuRmlContextUpdatePolicy TuRmlContextScheduler::GetPolicy(Rml::Context* context)
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+        auto it = m_contexts.find(context);
+        return it != m_contexts.end() ? it->second.policy : TuRmlContextUpdatePolicy{};
+    }
+
+    void TuRmlContextScheduler::SetMinimised(bool minimised)
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+        m_minimised = minimised;
+    }
+
+    bool TuRmlContextScheduler::IsHidden(Rml::Context* context)
+    {
+        for (int i = 0; i < context->GetNumDocuments(); ++i)
+        {
+            if (context->GetDocument(i)->IsVisible())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void TuRmlContextScheduler::UpdateContexts(const AZStd::function<void(Rml::Context*)>& updateContext,
+                                               const AZStd::function<void(Rml::Context*)>& holdContext)
+    {
+        AZ_PROFILE_FUNCTION(RmlBudget);
+        const double now = Rml::GetSystemInterface()->GetElapsedTime();
+
+        struct DueContext
+        {
+            Rml::Context* context = nullptr;
+            TuRmlContextUpdatePolicy::Priority priority = TuRmlContextUpdatePolicy::Priority::Normal;
+            //! Seconds since it was due
+            double overdue = 0.0;
+        };
+        AZStd::vector<DueContext> due;
+        AZStd::vector<Rml::Context*> held;
+
+        // Updates call into game code, which may change policies, so the lock is only held to pick contexts
+        {
+            AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+            for (int i = 0; i < Rml::GetNumContexts(); ++i)
+            {
+                Rml::Context* context = Rml::GetContext(i);
+                if (!context)
+                {
+                    continue;
+                }
+
+                const ContextState& state = m_contexts[context];
+                const TuRmlContextUpdatePolicy& policy = state.policy;
+                if (policy.pauseWhenHidden && (m_minimised || IsHidden(context)))
+                {
+                    held.push_back(context);
+                    continue;
+                }
+
+                const double interval = policy.updateRate > 0.0f ? 1.0 / policy.updateRate : 0.0;
+                const double overdue = state.lastUpdateTime < 0.0 ? interval : now - state.lastUpdateTime - interval;
+                if (overdue >= 0.0)
+                {
+                    due.push_back({ context, policy.priority, overdue });
+                }
+                else
+                {
+                    held.push_back(context);
+                }
+            }
+        }
+        for (Rml::Context* context : held)
+        {
+            holdContext(context);
+        }
+
+        // Higher priorities first, most overdue first within one
+        AZStd::stable_sort(due.begin(), due.end(),
+            [](const DueContext& lhs, const DueContext& rhs)
+            {
+                if (lhs.priority != rhs.priority)
+                {
+                    return lhs.priority > rhs.priority;
+                }
+                return lhs.overdue > rhs.overdue;
+            });
+
+        const double budgetMs = AZStd::max(static_cast<float>(r_rmlUpdateBudgetMs), 0.0f);
+        AZStd::chrono::steady_clock::time_point lowPriorityStart;
+        bool lowPriorityStarted = false;
+
+        AZStd::vector<Rml::Context*> updated;
+        for (const DueContext& dueContext : due)
+        {
+            // An earlier update may have run game code that destroyed this context, it left the map then
+            {
+                AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+                if (m_contexts.find(dueContext.context) == m_contexts.end())
+                {
+                    continue;
+                }
+            }
+
+            if (dueContext.priority == TuRmlContextUpdatePolicy::Priority::Low)
+            {
+                if (!lowPriorityStarted)
+                {
+                    lowPriorityStart = AZStd::chrono::steady_clock::now();
+                    lowPriorityStarted = true;
+                }
+                else
+                {
+                    const double elapsedMs = AZStd::chrono::duration<double, AZStd::milli>(
+                        AZStd::chrono::steady_clock::now() - lowPriorityStart).count();
+                    if (elapsedMs >= budgetMs)
+                    {
+                        holdContext(dueContext.context);
+                        continue;
+                    }
+                }
+            }
+
+            AZ_PROFILE_SCOPE(RmlBudget, "TuRml Context Update");
+            updateContext(dueContext.context);
+            updated.push_back(dueContext.context);
+        }
+
+        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+        for (Rml::Context* context : updated)
+        {
+            // A context destroyed by game code during a later update is gone from the map again
+            if (auto it = m_contexts.find(context); it != m_contexts.end())
+            {
+                it->second.lastUpdateTime = now;
+            }
+        }
+    }
+
+    int TuRmlContextScheduler::GetEventClasses()
+    {
+        return EVT_BASIC;
+    }
+
+    void TuRmlContextScheduler::OnContextDestroy(Rml::Context* context)
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+        m_contexts.erase(context);
+    }
+}
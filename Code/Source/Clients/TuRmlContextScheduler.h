@@ -0,0 +1,57 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#pragma once
+
+#include <TuRml/TuRmlBus.h>
+
+#include <AzCore/std/containers/unordered_map.h>
+#include <AzCore/std/functional.h>
+#include <AzCore/std/parallel/mutex.h>
+
+#include <RmlUi/Core/Plugin.h>
+
+namespace TuRml
+{
+    //! Decides which contexts get updated each tick from their TuRmlContextUpdatePolicy.
+    //! High and normal priority contexts are updated whenever their rate allows. Low priority ones that are due
+    //! are updated most overdue first until r_rmlUpdateBudgetMs is used up, the rest wait for a later tick.
+    //! At least one of them is updated per tick, so they can't starve.
+    //! Contexts skipped in a tick are held, their child passes submit the last draw list instead of rendering, so
+    //! the budget spreads their Render work over ticks along with their updates.
+    class TuRmlContextScheduler final
+        : public Rml::Plugin
+    {
+    public:
+        void SetPolicy(Rml::Context* context, const TuRmlContextUpdatePolicy& policy);
+        TuRmlContextUpdatePolicy GetPolicy(Rml::Context* context);
+
+        //! Contexts pausing when hidden aren't updated while the application is minimised
+        void SetMinimised(bool minimised);
+
+        //! Calls updateContext for every context due this tick and holdContext for every other one
+        void UpdateContexts(const AZStd::function<void(Rml::Context*)>& updateContext,
+                            const AZStd::function<void(Rml::Context*)>& holdContext);
+
+        // Rml::Plugin
+        int GetEventClasses() override;
+        void OnContextDestroy(Rml::Context* context) override;
+
+    private:
+        struct ContextState
+        {
+            TuRmlContextUpdatePolicy policy;
+            //! Elapsed time of the last update, negative until the first one
+            double lastUpdateTime = -1.0;
+        };
+
+        static bool IsHidden(Rml::Context* context);
+
+        AZStd::mutex m_mutex;
+        AZStd::unordered_map<Rml::Context*, ContextState> m_contexts;
+        bool m_minimised = false;
+    };
+}
@@ -0,0 +1,170 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#include "TuRmlContextTracker.h"
+
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/limits.h>
+
+#include <RmlUi/Core/Context.h>
+#include <RmlUi/Core/Core.h>
+#include <RmlUi/Core/ElementDocument.h>
+#include <RmlUi/Core/Event.h>
+#include <RmlUi/Core/SystemInterface.h>
+
+namespace TuRml
+{
+    // Document events that change what's drawn without going through layout or input
+    static constexpr const char* TrackedDocumentEvents[] = { "show", "hide", "focus", "blur", "scroll", "resize" };
+
+    TuRmlContextTracker::ContextState& TuRmlContextTracker::GetState(Rml::Context* context)
+    {
+        auto [it, inserted] = m_contexts.try_emplace(context);
+        if (inserted)
+        {
+            it->second.redrawTime = AZStd::numeric_limits<double>::infinity();
+        }
+        return it->second;
+    }
+
+    void TuRmlContextTracker::BeforeUpdate(Rml::Context* context)
+    {
+        // Changes made from code since the last update, the update lays them out straight away
+        bool layoutDirty = false;
+        for (int i = 0; i < context->GetNumDocuments() && !layoutDirty; ++i)
+        {
+            layoutDirty = context->GetDocument(i)->IsLayoutDirty();
+        }
+
+        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+        ContextState& state = GetState(context);
+        state.dirty |= layoutDirty;
+    }
+
+    void TuRmlContextTracker::AfterUpdate(Rml::Context* context)
+    {
+        const double now = Rml::GetSystemInterface()->GetElapsedTime();
+        const double delay = context->GetNextUpdateDelay();
+
+        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+        ContextState& state = GetState(context);
+        state.held = false;
+
+        // Animations and transitions ask for an update right away, caret blinking and the like after a delay
+        if (delay <= 0.0 || now >= state.redrawTime)
+        {
+            state.dirty = true;
+            state.redrawTime = AZStd::numeric_limits<double>::infinity();
+        }
+        if (delay > 0.0 && delay < AZStd::numeric_limits<double>::infinity())
+        {
+            state.redrawTime = AZStd::min(state.redrawTime, now + delay);
+        }
+
+        const Rml::Vector2i dimensions = context->GetDimensions();
+        const float densityRatio = context->GetDensityIndependentPixelRatio();
+        if (dimensions != state.dimensions || densityRatio != state.densityRatio)
+        {
+            state.dimensions = dimensions;
+            state.densityRatio = densityRatio;
+            state.dirty = true;
+        }
+    }
+
+    void TuRmlContextTracker::Invalidate(Rml::Context* context)
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+        if (context)
+        {
+            GetState(context).dirty = true;
+            return;
+        }
+
+        for (auto& [trackedContext, state] : m_contexts)
+        {
+            state.dirty = true;
+        }
+    }
+
+    bool TuRmlContextTracker::ConsumeDirty(Rml::Context* context)
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+        ContextState& state = GetState(context);
+        const bool dirty = state.dirty;
+        state.dirty = false;
+        return dirty;
+    }
+
+    void TuRmlContextTracker::Hold(Rml::Context* context)
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+        GetState(context).held = true;
+    }
+
+    bool TuRmlContextTracker::IsHeld(Rml::Context* context)
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+        auto it = m_contexts.find(context);
+        return it != m_contexts.end() && it->second.held;
+    }
+
+    int TuRmlContextTracker::GetEventClasses()
+    {
+        return EVT_BASIC | EVT_DOCUMENT | EVT_ELEMENT;
+    }
+
+    void TuRmlContextTracker::OnContextDestroy(Rml::Context* context)
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+        m_contexts.erase(context);
+    }
+
+    void TuRmlContextTracker::OnDocumentLoad(Rml::ElementDocument* document)
+    {
+        // Capture phase, so events targeting any element of the document are seen
+        for (const char* eventType : TrackedDocumentEvents)
+        {
+            document->AddEventListener(eventType, this, true);
+        }
+        Invalidate(document->GetContext());
+    }
+
+    void TuRmlContextTracker::OnDocumentUnload(Rml::ElementDocument* document)
+    {
+        for (const char* eventType : TrackedDocumentEvents)
+        {
+            document->RemoveEventListener(eventType, this, true);
+        }
+        Invalidate(document->GetContext());
+    }
+
+    void TuRmlContextTracker::OnElementCreate(Rml::Element* element)
+    {
+        // Usually not attached to a context yet, attaching it dirties the layout of the document it's added to.
+        // Invalidating every context instead would redraw all of them whenever any data-for creates elements.
+        if (Rml::Context* context = element->GetContext())
+        {
+            Invalidate(context);
+        }
+    }
+
+    void TuRmlContextTracker::OnElementDestroy(Rml::Element* element)
+    {
+        if (Rml::Context* context = element->GetContext())
+        {
+            Invalidate(context);
+        }
+    }
+
+    void TuRmlContextTracker::ProcessEvent(Rml::Event& event)
+    {
+        Rml::Element* element = event.GetCurrentElement();
+        if (Rml::Context* context = element ? element->GetContext() : nullptr)
+        {
+            Invalidate(context);
+        }
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#pragma once
+
+#include <AzCore/std/containers/unordered_map.h>
+#include <AzCore/std/parallel/mutex.h>
+
+#include <RmlUi/Core/EventListener.h>
+#include <RmlUi/Core/Plugin.h>
+#include <RmlUi/Core/Types.h>
+
+namespace TuRml
+{
+    //! Tracks whether a context changed since it was last rendered, so its child pass can submit the previous
+    //! draw list again instead of calling Rml::Context::Render.
+    //! A context is dirty after input, while it animates or has a timed update pending (RmlUi's next update delay),
+    //! when its layout was invalidated, when its size changes, when elements or documents are created or destroyed,
+    //! on document show/hide/focus/scroll events and when invalidated explicitly.
+    //! RmlUi has no hook for property changes on every element type, so a change applied inside
+    //! Rml::Context::Update that doesn't go through layout (data-class, data-style, :checked, a style set from code)
+    //! isn't seen. That's why r_rmlRetainedMode is opt-in, UIs using it invalidate their context for such changes.
+    class TuRmlContextTracker final
+        : public Rml::Plugin
+        , public Rml::EventListener
+    {
+    public:
+        //! Call around Rml::Context::Update every tick
+        void BeforeUpdate(Rml::Context* context);
+        void AfterUpdate(Rml::Context* context);
+
+        //! nullptr invalidates every context
+        void Invalidate(Rml::Context* context);
+
+        //! Returns true if the context has to be rendered and clears the flag, new contexts start dirty
+        bool ConsumeDirty(Rml::Context* context);
+
+        //! The scheduler skipped the context this tick. Until its next update its child pass keeps the last draw list,
+        //! with or without r_rmlRetainedMode, and leaves the dirty flag for the tick it's updated on.
+        void Hold(Rml::Context* context);
+        bool IsHeld(Rml::Context* context);
+
+        // Rml::Plugin
+        int GetEventClasses() override;
+        void OnContextDestroy(Rml::Context* context) override;
+        void OnDocumentLoad(Rml::ElementDocument* document) override;
+        void OnDocumentUnload(Rml::ElementDocument* document) override;
+        void OnElementCreate(Rml::Element* element) override;
+        void OnElementDestroy(Rml::Element* element) override;
+
+        // Rml::EventListener
+        void ProcessEvent(Rml::Event& event) override;
+
+    private:
+        struct ContextState
+        {
+            bool dirty = true;
+            Rml::Vector2i dimensions;
+            float densityRatio = 1.0f;
+            //! Elapsed time at which RmlUi asked to be updated again
+            double redrawTime = 0.0;
+            //! Skipped by the scheduler since its last update
+            bool held = false;
+        };
+
+        ContextState& GetState(Rml::Context* context);
+
+        AZStd::mutex m_mutex;
+        AZStd::unordered_map<Rml::Context*, ContextState> m_contexts;
+    };
+}
@@ -81,6 +81,69 @@ namespace TuRml
         return m_renderInterface.get();
     }
 
+    void TuRmlSystemComponent::PreloadTextures(const AZStd::vector<AZStd::string>& texturePaths)
+    {
+        if (m_renderInterface)
+        {
+            m_renderInterface->PreloadTextures(texturePaths);
+        }
+    }
+
+    void TuRmlSystemComponent::PreloadDocumentTextures(Rml::ElementDocument* document)
+    {
+        if (m_renderInterface)
+        {
+            m_renderInterface->PreloadDocumentTextures(document);
+        }
+    }
+
+    void TuRmlSystemComponent::ClearPreloadedTextures()
+    {
+        if (m_renderInterface)
+        {
+            m_renderInterface->ClearPreloadedTextures();
+        }
+    }
+
+    void TuRmlSystemComponent::InvalidateContext(Rml::Context* context)
+    {
+        m_contextTracker.Invalidate(context);
+    }
+
+    TuRmlContextTracker* TuRmlSystemComponent::GetContextTracker()
+    {
+        return &m_contextTracker;
+    }
+
+    void TuRmlSystemComponent::SetContextUpdatePolicy(Rml::Context* context, const TuRmlContextUpdatePolicy& policy)
+    {
+        m_contextScheduler.SetPolicy(context, policy);
+    }
+
+    TuRmlContextUpdatePolicy TuRmlSystemComponent::GetContextUpdatePolicy(Rml::Context* context)
+    {
+        return m_contextScheduler.GetPolicy(context);
+    }
+
+    void TuRmlSystemComponent::WarmPipelineStates(AZ::RHI::Format colorFormat, uint16_t sampleCount)
+    {
+        if (m_renderInterface)
+        {
+            m_renderInterface->GetPipelineStateCache().Warm(
+                TuRmlPipelineStateKey::ForDirectPipeline(colorFormat, sampleCount));
+        }
+    }
+
+    void TuRmlSystemComponent::OnApplicationConstrained([[maybe_unused]] Event lastEvent)
+    {
+        m_contextScheduler.SetMinimised(true);
+    }
+
+    void TuRmlSystemComponent::OnApplicationUnconstrained([[maybe_unused]] Event lastEvent)
+    {
+        m_contextScheduler.SetMinimised(false);
+    }
+
     void TuRmlSystemComponent::Init()
     {
     }
@@ -88,6 +151,7 @@ namespace TuRml
     void TuRmlSystemComponent::Activate()
     {
         AZ::SystemTickBus::Handler::BusConnect();
+        AzFramework::ApplicationLifecycleEvents::Bus::Handler::BusConnect();
         TuRmlRequestBus::Handler::BusConnect();
         TuRmlInterface::Register(this);
 
@@ -102,6 +166,9 @@ namespace TuRml
             AZ_Error("TuRml", false, "Failed to initialise RmlUi");
             return;
         }
+        Rml::RegisterPlugin(&m_contextTracker);
+        Rml::RegisterPlugin(&m_contextScheduler);
+        Rml::RegisterPlugin(m_renderInterface.get());
 
         Rml::LoadFontFace("Fonts/Roboto-Regular.ttf");
         Rml::LoadFontFace("Fonts/Roboto-Bold.ttf");
@@ -115,6 +182,8 @@ namespace TuRml
         auto* passSystem = AZ::RPI::PassSystemInterface::Get();
         passSystem->AddPassCreator(AZ::Name("TuRmlParentPass"), &TuRmlParentPass::Create);
         passSystem->AddPassCreator(AZ::Name("TuRmlChildPass"), &TuRmlChildPass::Create);
+        // The first pass would otherwise stall on loading the shaders and building the render target output
+        m_renderInterface->GetPipelineStateCache().Warm();
 
         AZ::RPI::FeatureProcessorFactory::Get()->RegisterFeatureProcessor<TuRmlFeatureProcessor>();
     }
@@ -122,12 +191,20 @@ namespace TuRml
     void TuRmlSystemComponent::Deactivate()
     {
         AZ::SystemTickBus::Handler::BusDisconnect();
+        AzFramework::ApplicationLifecycleEvents::Bus::Handler::BusDisconnect();
+        if (m_renderInterface)
+        {
+            m_renderInterface->WaitForDrawLists();
+        }
         m_inputInterface.Shutdown();
         m_fileInterface.Shutdown();
         m_systemInterface.Shutdown();
 
         AZ::RPI::FeatureProcessorFactory::Get()->UnregisterFeatureProcessor<TuRmlFeatureProcessor>();
 
+        Rml::UnregisterPlugin(m_renderInterface.get());
+        Rml::UnregisterPlugin(&m_contextScheduler);
+        Rml::UnregisterPlugin(&m_contextTracker);
         Rml::Shutdown();
 
         if (m_renderInterface)
@@ -141,14 +218,25 @@ namespace TuRml
 
     void TuRmlSystemComponent::OnSystemTick()
     {
-        const auto numCtxs = Rml::GetNumContexts();
-        for (auto i = 0; i < numCtxs; ++i)
+        if (m_renderInterface)
         {
-            auto ctx = Rml::GetContext(i);
-            if (ctx == nullptr)
-                continue;
-
-            ctx->Update();
+            // Contexts are about to change, the last draw list job must be done with them
+            m_renderInterface->WaitForDrawLists();
+            m_renderInterface->AdvanceFrame();
+            m_renderInterface->UpdatePendingTextures();
         }
+
+        // Contexts skipped this tick are held, so their child passes keep the last draw list instead of rendering
+        m_contextScheduler.UpdateContexts(
+            [this](Rml::Context* ctx)
+            {
+                m_contextTracker.BeforeUpdate(ctx);
+                ctx->Update();
+                m_contextTracker.AfterUpdate(ctx);
+            },
+            [this](Rml::Context* ctx)
+            {
+                m_contextTracker.Hold(ctx);
+            });
     }
 } // namespace TuRml
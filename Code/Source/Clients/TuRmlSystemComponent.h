@@ -10,6 +10,8 @@
 #include "Interfaces/TuFile.h"
 #include "Interfaces/TuInput.h"
 #include "Interfaces/TuSystem.h"
+#include "TuRmlContextScheduler.h"
+#include "TuRmlContextTracker.h"
 
 #include <AzCore/Component/Component.h>
 #include <AzCore/Component/TickBus.h>
@@ -18,6 +20,7 @@
 #include <AzCore/Asset/AssetManager.h>
 #include <AzCore/IO/FileIO.h>
 
+#include <AzFramework/API/ApplicationAPI.h>
 #include <AzFramework/Input/Events/InputChannelEventListener.h>
 #include <AzFramework/Input/Buses/Notifications/InputTextNotificationBus.h>
 
@@ -29,6 +32,7 @@ namespace TuRml
         : public AZ::Component
         , protected TuRmlRequestBus::Handler
         , protected AZ::SystemTickBus::Handler
+        , protected AzFramework::ApplicationLifecycleEvents::Bus::Handler
     {
     public:
         AZ_COMPONENT_DECL(TuRmlSystemComponent);
@@ -47,6 +51,14 @@ namespace TuRml
         ////////////////////////////////////////////////////////////////////////
         // TuRmlRequestBus interface implementation
         TuRmlRenderInterface* GetRenderInterface() override;
+        void PreloadTextures(const AZStd::vector<AZStd::string>& texturePaths) override;
+        void PreloadDocumentTextures(Rml::ElementDocument* document) override;
+        void ClearPreloadedTextures() override;
+        void InvalidateContext(Rml::Context* context) override;
+        TuRmlContextTracker* GetContextTracker() override;
+        void SetContextUpdatePolicy(Rml::Context* context, const TuRmlContextUpdatePolicy& policy) override;
+        TuRmlContextUpdatePolicy GetContextUpdatePolicy(Rml::Context* context) override;
+        void WarmPipelineStates(AZ::RHI::Format colorFormat, uint16_t sampleCount) override;
         ////////////////////////////////////////////////////////////////////////
 
         ////////////////////////////////////////////////////////////////////////
@@ -59,10 +71,16 @@ namespace TuRml
         //AZ::SystemTickBus
         void OnSystemTick() override;
 
+        //AzFramework::ApplicationLifecycleEvents
+        void OnApplicationConstrained(Event lastEvent) override;
+        void OnApplicationUnconstrained(Event lastEvent) override;
+
     private:
         TuFile m_fileInterface;
         TuInput m_inputInterface;
         TuSystem m_systemInterface;
+        TuRmlContextTracker m_contextTracker;
+        TuRmlContextScheduler m_contextScheduler;
         AZStd::unique_ptr<TuRmlRenderInterface> m_renderInterface;
     };
 
@@ -0,0 +1,128 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#pragma once
+
+#include <AzCore/std/containers/array.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzCore/std/parallel/mutex.h>
+
+#include <TuRml/Allocators.h>
+
+namespace TuRml
+{
+    //! Recycles the CPU buffers of compiled geometry.
+    //! Buffers are grouped into power of two size classes by capacity, Acquire hands out one of the smallest class
+    //! that fits and Release puts it back, so compiling and releasing geometry every frame stops hitting the
+    //! allocator. Idle buffers are dropped once they'd exceed the pool's byte limit, buffers above the largest class
+    //! are never pooled.
+    template<typename T>
+    class TuRmlBufferPool
+    {
+    public:
+        AZ_CLASS_ALLOCATOR(TuRmlBufferPool, TuRmlRenderAllocator);
+
+        struct Stats
+        {
+            size_t acquireCount = 0;
+            //! Acquires served from an idle buffer
+            size_t reuseCount = 0;
+            size_t idleBuffers = 0;
+            size_t idleBytes = 0;
+            //! Bytes handed out and not released yet
+            size_t liveBytes = 0;
+        };
+
+        //! Returns a buffer holding count default initialised elements
+        AZStd::vector<T> Acquire(size_t count)
+        {
+            AZStd::vector<T> buffer;
+            const size_t sizeClass = GetSizeClass(count);
+            {
+                AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+                ++m_stats.acquireCount;
+                if (sizeClass < SizeClassCount && !m_idle[sizeClass].empty())
+                {
+                    buffer = AZStd::move(m_idle[sizeClass].back());
+                    m_idle[sizeClass].pop_back();
+                    --m_stats.idleBuffers;
+                    m_stats.idleBytes -= buffer.capacity() * sizeof(T);
+                    ++m_stats.reuseCount;
+                }
+            }
+
+            if (buffer.capacity() == 0)
+            {
+                buffer.reserve(sizeClass < SizeClassCount ? GetClassCapacity(sizeClass) : count);
+            }
+            buffer.resize(count);
+
+            AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+            m_stats.liveBytes += buffer.capacity() * sizeof(T);
+            return buffer;
+        }
+
+        //! Takes the buffer's memory, it is left empty without capacity
+        void Release(AZStd::vector<T>& buffer)
+        {
+            if (buffer.capacity() == 0)
+            {
+                return;
+            }
+
+            AZStd::vector<T> released = AZStd::move(buffer);
+            buffer = {};
+            released.clear();
+
+            const size_t bytes = released.capacity() * sizeof(T);
+            const size_t sizeClass = GetSizeClass(released.capacity());
+
+            AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+            m_stats.liveBytes -= AZStd::min(m_stats.liveBytes, bytes);
+            // Only exact class capacities come from Acquire, anything else isn't worth keeping
+            if (sizeClass < SizeClassCount && released.capacity() == GetClassCapacity(sizeClass) &&
+                m_stats.idleBytes + bytes <= m_maxIdleBytes)
+            {
+                m_idle[sizeClass].push_back(AZStd::move(released));
+                ++m_stats.idleBuffers;
+                m_stats.idleBytes += bytes;
+            }
+        }
+
+        void SetMaxIdleBytes(size_t maxIdleBytes)
+        {
+            AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+            m_maxIdleBytes = maxIdleBytes;
+        }
+
+        Stats GetStats()
+        {
+            AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+            return m_stats;
+        }
+
+    private:
+        static constexpr size_t MinClassCapacity = 64;
+        static constexpr size_t SizeClassCount = 11; // 64 to 64K elements
+
+        static size_t GetClassCapacity(size_t sizeClass) { return MinClassCapacity << sizeClass; }
+
+        static size_t GetSizeClass(size_t count)
+        {
+            size_t sizeClass = 0;
+            while (sizeClass < SizeClassCount && GetClassCapacity(sizeClass) < count)
+            {
+                ++sizeClass;
+            }
+            return sizeClass;
+        }
+
+        AZStd::mutex m_mutex;
+        AZStd::array<AZStd::vector<AZStd::vector<T>>, SizeClassCount> m_idle;
+        size_t m_maxIdleBytes = 0;
+        Stats m_stats;
+    };
+}
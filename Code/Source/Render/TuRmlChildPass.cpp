@@ -5,22 +5,25 @@
  * For complete copyright and license terms please see the LICENSE at the root of this distribution.
  */
 #include "TuRmlChildPass.h"
+#include "TuRmlContextRenderInterface.h"
 #include "TuRmlRenderInterface.h"
+#include "../Clients/TuRmlContextTracker.h"
 
 #include <AzCore/Name/Name.h>
 #include <AzCore/Console/ILogger.h>
 #include <AzCore/Console/IConsole.h>
 #include <AzCore/Jobs/Algorithms.h>
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/math.h>
 
 #include <Atom/RPI.Public/Shader/Shader.h>
-#include <Atom/RPI.Public/RPIUtils.h>
 #include <Atom/RPI.Public/PipelineState.h>
 #include <Atom/RPI.Public/Image/AttachmentImage.h>
 #include <Atom/RPI.Public/Shader/ShaderResourceGroup.h>
 #include <Atom/RHI/DeviceDrawItem.h>
 #include <Atom/RHI/GeometryView.h>
-#include <Atom/RHI.Reflect/InputStreamLayoutBuilder.h>
 #include <Atom/RHI.Reflect/ImageDescriptor.h>
+#include <Atom/RHI.Reflect/ShaderInputNameIndex.h>
 
 #include <RmlUi/Core.h>
 #include <TuRml/TuRmlBus.h>
@@ -28,87 +31,107 @@
 
 namespace TuRml
 {
-    AZ_CVAR(int, r_rmlMSAA, 2, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
-            "MSAA sample count for TuRml UI rendering in direct pipeline mode (1=no MSAA, 2=2x, 4=4x, 8=8x)");
-
-    SrgRecycler::SrgRecycler(const AZ::Data::Instance<AZ::RPI::Shader>& shader)
-        : m_shader(shader)
+    AZ_CVAR(int, r_rmlMSAA, 1, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "MSAA sample count for TuRml UI rendering in direct pipeline mode (1=no MSAA, 4=4x), contexts render to "
+            "a multisampled target that is resolved onto the pipeline. Off by default, r_rmlAnalyticAA smooths "
+            "edges without the extra targets. Counts the device doesn't support fall back to 4x or no MSAA");
+    AZ_CVAR(bool, r_rmlRetainedMode, false, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Skip Rml::Context::Render and submit the previous draw list again while a context is unchanged. "
+            "Property changes that don't affect layout (data-class, data-style, :checked, styles set from code) "
+            "aren't detected, contexts using it call TuRmlRequests::InvalidateContext for them");
+    AZ_CVAR(int, r_rmlParallelDrawPrepThreshold, 512, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Draw count from which CompileResources prepares draw data on the job system, 0 keeps it serial");
+    AZ_CVAR(int, r_rmlParallelDrawPrepChunkSize, 128, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Draw commands prepared per job when draw data preparation runs in parallel");
+    AZ_CVAR(bool, r_rmlDamageTracking, true, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Render targets keep their previous contents and only redraw the area covered by changed draws");
+
+    static bool IsSameDrawCommand(const TuRmlDrawCommand& lhs, const TuRmlDrawCommand& rhs)
     {
+        return lhs.drawType == rhs.drawType &&
+            lhs.geometrySerial == rhs.geometrySerial &&
+            lhs.translation == rhs.translation &&
+            lhs.texture == rhs.texture &&
+            lhs.transform == rhs.transform &&
+            lhs.scissorRegion == rhs.scissorRegion &&
+            lhs.clipmaskEnabled == rhs.clipmaskEnabled &&
+            lhs.stencilRef == rhs.stencilRef &&
+            lhs.clipmask_op == rhs.clipmask_op;
     }
 
-    SrgRecycler::Srg* SrgRecycler::GetSrg()
+    static bool IsSameDraw(const FrameInfo& lhsFrame, const TuRmlChildPassDrawCommand& lhs,
+                           const FrameInfo& rhsFrame, const TuRmlChildPassDrawCommand& rhs)
     {
-        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
-        for (auto& srg : m_srgs)
+        if (!IsSameDrawCommand(lhs.drawCommand, rhs.drawCommand) || (lhs.batchIndex < 0) != (rhs.batchIndex < 0) ||
+            lhs.instanceCount != rhs.instanceCount)
         {
-            if (!srg->inUse)
-            {
-                srg->inUse = true;
-                return srg.get();
-            }
+            return false;
         }
-
-        auto srg = AZ::RPI::ShaderResourceGroup::Create(
-            m_shader->GetAsset(), m_shader->GetSupervariantIndex(), AZ::Name("DrawSrg"));
-        if (srg == nullptr)
+        if (lhs.instanceCount > 1)
         {
-            AZ_Error("SrgRecycler", false, "Failed to create srg resource");
-            return nullptr;
+            return AZStd::equal(
+                lhsFrame.instanceTranslations.begin() + lhs.firstInstance,
+                lhsFrame.instanceTranslations.begin() + lhs.firstInstance + lhs.instanceCount,
+                rhsFrame.instanceTranslations.begin() + rhs.firstInstance);
+        }
+        if (lhs.batchIndex < 0)
+        {
+            return true;
         }
 
-        m_srgs.push_back(AZStd::make_unique<Srg>(srg, true));
-        return m_srgs.back().get();
-    }
-
-    void SrgRecycler::FreeSrg(Srg* srg)
-    {
-        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
-        srg->inUse = false;
+        const TuRmlDrawBatch& lhsBatch = lhsFrame.batches[lhs.batchIndex];
+        const TuRmlDrawBatch& rhsBatch = rhsFrame.batches[rhs.batchIndex];
+        if (lhsBatch.sourceCount != rhsBatch.sourceCount)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < lhsBatch.sourceCount; ++i)
+        {
+            if (!IsSameDrawCommand(lhsFrame.batchSources[lhsBatch.firstSource + i],
+                                   rhsFrame.batchSources[rhsBatch.firstSource + i]))
+            {
+                return false;
+            }
+        }
+        return true;
     }
 
-    void FrameInfo::EnsureTransientBufferCapacity(size_t vertexCount, size_t indexCount)
+    void FrameInfo::EnsureDrawConstantsCapacity(size_t drawCount, const AZ::Data::Instance<AZ::RPI::Shader>& shader)
     {
-        const size_t vertexBytes = vertexCount * sizeof(Rml::Vertex);
-        const size_t indexBytes = indexCount * sizeof(int);
-
-        // Create or resize vertex buffer if needed
-        if (!m_sharedVertexBuffer || m_sharedVertexCapacity < vertexBytes)
+        if (!m_drawSrg)
         {
-            // Grow by 1.5x to reduce frequent reallocations
-            const size_t newCapacity = AZStd::max(vertexBytes, m_sharedVertexCapacity * 3 / 2);
-
-            AZ::RPI::CommonBufferDescriptor desc;
-            desc.m_poolType = AZ::RPI::CommonBufferPoolType::DynamicInputAssembly;
-            desc.m_bufferName = "TuRml Shared Transient Vertex Buffer";
-            desc.m_byteCount = newCapacity;
-            desc.m_elementSize = sizeof(Rml::Vertex);
-            desc.m_bufferData = nullptr;
-
-            m_sharedVertexBuffer = AZ::RPI::BufferSystemInterface::Get()->CreateBufferFromCommonPool(desc);
-            m_sharedVertexCapacity = newCapacity;
-
-            AZ_Info("TuRmlChildPass", "Allocated shared vertex buffer: %zu bytes (%zu vertices)",
-                    newCapacity, newCapacity / sizeof(Rml::Vertex));
+            m_drawSrg = AZ::RPI::ShaderResourceGroup::Create(
+                shader->GetAsset(), shader->GetSupervariantIndex(), AZ::Name("DrawSrg"));
+            if (!m_drawSrg)
+            {
+                AZ_Error("TuRmlChildPass", false, "Failed to create DrawSrg");
+                return;
+            }
         }
 
-        // Create or resize index buffer if needed
-        if (!m_sharedIndexBuffer || m_sharedIndexCapacity < indexBytes)
+        if (m_drawConstantsBuffer && m_drawConstantsCapacity >= drawCount)
         {
-            const size_t newCapacity = AZStd::max(indexBytes, m_sharedIndexCapacity * 3 / 2);
+            return;
+        }
 
-            AZ::RPI::CommonBufferDescriptor desc;
-            desc.m_poolType = AZ::RPI::CommonBufferPoolType::DynamicInputAssembly;
-            desc.m_bufferName = "TuRml Shared Transient Index Buffer";
-            desc.m_byteCount = newCapacity;
-            desc.m_elementSize = sizeof(int);
-            desc.m_bufferData = nullptr;
+        const size_t newCapacity = AZStd::max(AZStd::max(drawCount, m_drawConstantsCapacity * 3 / 2), size_t(64));
 
-            m_sharedIndexBuffer = AZ::RPI::BufferSystemInterface::Get()->CreateBufferFromCommonPool(desc);
-            m_sharedIndexCapacity = newCapacity;
+        AZ::RPI::CommonBufferDescriptor desc;
+        desc.m_poolType = AZ::RPI::CommonBufferPoolType::ReadOnly;
+        desc.m_bufferName = "TuRml Draw Constants Buffer";
+        desc.m_byteCount = newCapacity * sizeof(TuRmlDrawConstants);
+        desc.m_elementSize = sizeof(TuRmlDrawConstants);
+        desc.m_bufferData = nullptr;
 
-            AZ_Info("TuRmlChildPass", "Allocated shared index buffer: %zu bytes (%zu indices)",
-                    newCapacity, newCapacity / sizeof(int));
-        }
+        m_drawConstantsBuffer = AZ::RPI::BufferSystemInterface::Get()->CreateBufferFromCommonPool(desc);
+        m_drawConstantsCapacity = newCapacity;
+
+        // The only time the SRG needs compiling, its contents are written through the buffer
+        AZ::RHI::ShaderInputNameIndex drawConstantsIndex = "m_drawConstants";
+        m_drawSrg->SetBuffer(drawConstantsIndex, m_drawConstantsBuffer);
+        m_drawSrg->Compile();
+
+        AZ_Info("TuRmlChildPass", "Allocated draw constants buffer: %zu draws", newCapacity);
     }
 
     AZ::RPI::Ptr<TuRmlChildPass> TuRmlChildPass::Create(const AZ::RPI::PassDescriptor& descriptor)
@@ -116,25 +139,63 @@ namespace TuRml
         return aznew TuRmlChildPass(descriptor);
     }
 
-    void TuRmlChildPass::UpdateRenderTarget(AZ::Data::Instance<AZ::RPI::AttachmentImage> attachmentImage)
+    void TuRmlChildPass::UpdateRenderTarget(AZ::Data::Instance<AZ::RPI::AttachmentImage> attachmentImage,
+                                            AZ::Data::Instance<AZ::RPI::AttachmentImage> depthStencilImage)
     {
         m_attachmentImage = attachmentImage;
+        m_depthStencilImage = depthStencilImage;
+        m_renderTargetValid = false;
         QueueForBuildAndInitialization();
     }
 
+    void TuRmlChildPass::UpdateContextDirty()
+    {
+        TuRmlContextTracker* contextTracker = nullptr;
+        TuRmlRequestBus::BroadcastResult(contextTracker, &TuRmlRequestBus::Events::GetContextTracker);
+        TuRmlRenderInterface* renderInterface = nullptr;
+        TuRmlRequestBus::BroadcastResult(renderInterface, &TuRmlRequestBus::Events::GetRenderInterface);
+
+        // Skipped by the scheduler, it renders on the tick it's updated on, with whatever made it dirty meanwhile
+        m_contextHeld = contextTracker && m_rmlContext && contextTracker->IsHeld(m_rmlContext);
+        // Otherwise always consumed, so a context doesn't stay dirty while retained mode is off
+        m_contextDirty = !m_contextHeld &&
+            (!contextTracker || !m_rmlContext || contextTracker->ConsumeDirty(m_rmlContext));
+
+        // The render target keeps what was drawn last, the pass only has to run when that would look different
+        // A draw list recorded ahead that never ran still has to be drawn
+        m_renderTargetClean = (r_rmlRetainedMode || m_contextHeld) && m_attachmentImage && m_renderTargetValid && !m_contextDirty &&
+            !m_drawCommandsRecorded && renderInterface &&
+            m_drawCommands.Get().textureGeneration == renderInterface->GetTextureGeneration();
+        if (m_renderTargetClean)
+        {
+            ++m_skippedFrameCount;
+        }
+    }
+
+    bool TuRmlChildPass::IsEnabled() const
+    {
+        return RasterPass::IsEnabled() && !m_renderTargetClean;
+    }
+
     TuRmlChildPass::TuRmlChildPass(const AZ::RPI::PassDescriptor& descriptor)
         : RasterPass(descriptor)
     {
-        m_drawCommands.m_drawCommands[0] = {};
-        m_drawCommands.m_drawCommands[1] = {};
     }
 
     void TuRmlChildPass::BuildInternal()
     {
+        m_renderTargetValid = false;
+        // The output may have changed, CompileResources picks the matching pipeline states up again
+        m_pipelineStates = {};
+
         // Two modes: render to specific target or render to main pipeline
         if (m_attachmentImage)
         {
             AttachImageToSlot(AZ::Name("ColorOutput"), m_attachmentImage);
+            if (m_depthStencilImage)
+            {
+                AttachImageToSlot(AZ::Name("DepthStencilOutput"), m_depthStencilImage);
+            }
 
             auto imageSize = m_attachmentImage->GetDescriptor().m_size;
             m_scissorState = AZ::RHI::Scissor(0, 0, imageSize.m_width, imageSize.m_height);
@@ -165,293 +226,273 @@ namespace TuRml
             return;
         }
         m_attachmentImage = nullptr;
+        m_depthStencilImage = nullptr;
+        m_renderTargetClean = false;
         QueueForBuildAndInitialization();
     }
 
     void TuRmlChildPass::SetupFrameGraphDependencies(AZ::RHI::FrameGraphInterface frameGraph)
     {
         AZ_PROFILE_FUNCTION(RmlBudget);
-        RasterPass::SetupFrameGraphDependencies(frameGraph);
-
-        if (m_rmlContext == nullptr)
-            return;
 
+        // Recorded before the attachments are declared, a partial redraw loads the render target instead of clearing.
+        // Usually the render interface's draw list job recorded it already while the rest of the frame ran.
         TuRmlRenderInterface* renderInterface = nullptr;
         TuRmlRequestBus::BroadcastResult(renderInterface, &TuRmlRequestBus::Events::GetRenderInterface);
-        if (renderInterface == nullptr)
-            return;
-
-        m_drawCommands.NextBuffer();
-
-        renderInterface->Begin(m_rmlContext, this);
+        if (renderInterface)
+        {
+            renderInterface->WaitForDrawLists();
+        }
+        if (!m_drawCommandsRecorded)
+        {
+            RecordDrawCommands();
+        }
+        m_drawCommandsRecorded = false;
+        // The damage can't be cleared without the clear pipeline state, and with nothing left to draw the
+        // build doesn't run at all
+        if (m_partialRedraw && (!m_pipelineStates.clearColor || m_drawCommands.Get().drawCmds.empty()))
         {
-            AZ_PROFILE_SCOPE(RmlBudget, "Rml::Context::Render");
-            m_rmlContext->Render();
+            m_partialRedraw = false;
+        }
+        if (m_attachmentImage)
+        {
+            if (AZ::RPI::PassAttachmentBinding* binding = FindAttachmentBinding(AZ::Name("ColorOutput")))
+            {
+                binding->m_unifiedScopeDesc.m_loadStoreAction.m_loadAction = m_partialRedraw ?
+                    AZ::RHI::AttachmentLoadAction::Load : AZ::RHI::AttachmentLoadAction::Clear;
+            }
         }
-        renderInterface->End();
+
+        RasterPass::SetupFrameGraphDependencies(frameGraph);
 
         auto drawCount = static_cast<uint32_t>(m_drawCommands.Get().drawCmds.size());
         frameGraph.SetEstimatedItemCount(drawCount);
     }
 
-    void TuRmlChildPass::StandardPipelineStateInit(AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw>& ps)
+    void TuRmlChildPass::RecordDrawCommandsAhead()
     {
-        ps = aznew AZ::RPI::PipelineStateForDraw;
-        ps->Init(AZ::RPI::LoadCriticalShader("Shaders/TuRml/UIElement.azshader"));
-        AZ::RHI::InputStreamLayoutBuilder layoutBuilder;
-        layoutBuilder.AddBuffer()
-                     ->Channel("POSITION", AZ::RHI::Format::R32G32_FLOAT)
-                     ->Channel("COLOR", AZ::RHI::Format::R8G8B8A8_UNORM)
-                     ->Channel("TEXCOORD0", AZ::RHI::Format::R32G32_FLOAT);
-        ps->InputStreamLayout() = layoutBuilder.End();
+        // The previous draw list never reached the render target, it can't be kept or diffed against
+        if (m_drawCommandsRecorded)
+        {
+            m_renderTargetValid = false;
+        }
+        RecordDrawCommands();
+        m_drawCommandsRecorded = true;
     }
 
-    void TuRmlChildPass::StandardPipelineStateFinish(AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw>& ps)
+    void TuRmlChildPass::RecordDrawCommands()
     {
-        ps->SetOutputFromPass(this);
-        ps->Finalize();
-    }
+        m_partialRedraw = false;
 
-    void TuRmlChildPass::CreatePipelineStates(PipelineStates& states, AZ::Data::Instance<AZ::RPI::Shader> shader)
-    {
-        if (!shader)
-        {
+        if (m_rmlContext == nullptr)
             return;
-        }
-        AZ_PROFILE_FUNCTION(RmlBudget);
-
-        if (states.standard == nullptr)
-        {
-            StandardPipelineStateInit(states.standard);
 
-            AZ::RHI::RenderStates& renderStates = states.standard->RenderStatesOverlay();
-            renderStates.m_depthStencilState.m_depth.m_enable = false;
-            auto& stencilState = renderStates.m_depthStencilState.m_stencil;
-            stencilState.m_enable = false;
-            stencilState.m_frontFace.m_failOp = AZ::RHI::StencilOp::Keep;
-            stencilState.m_frontFace.m_passOp = AZ::RHI::StencilOp::Keep;
-            stencilState.m_frontFace.m_depthFailOp = AZ::RHI::StencilOp::Keep;
-            stencilState.m_frontFace.m_func = AZ::RHI::ComparisonFunc::Equal;
-            stencilState.m_writeMask = 0xFF;
-            stencilState.m_readMask = 0xFF;
-
-            stencilState.m_backFace = stencilState.m_frontFace;
-
-            StandardPipelineStateFinish(states.standard);
+        TuRmlRenderInterface* renderInterface = nullptr;
+        TuRmlRequestBus::BroadcastResult(renderInterface, &TuRmlRequestBus::Events::GetRenderInterface);
+        if (renderInterface == nullptr)
+            return;
 
-            states.standard->GetRHIPipelineState()->GetDevicePipelineState(0)->SetName(
-                AZ::Name("TuRml Standard Standard"));
-        }
+        // Geometry released since the last frame may still be in the draw list
+        const FrameInfo& lastFrame = m_drawCommands.Get();
+        m_reusedFrame = (r_rmlRetainedMode || m_contextHeld) && !m_contextDirty && lastFrame.retainable &&
+            lastFrame.queuedFreeGeos.empty() && lastFrame.textureGeneration == renderInterface->GetTextureGeneration() &&
+            lastFrame.geometryGeneration == renderInterface->GetGeometryGeneration();
 
-        if (states.standardStencilTest == nullptr)
+        if (m_reusedFrame)
         {
-            StandardPipelineStateInit(states.standardStencilTest);
-
-            AZ::RHI::RenderStates& renderStates = states.standardStencilTest->RenderStatesOverlay();
-            renderStates.m_depthStencilState.m_depth.m_enable = false;
-            auto& stencilState = renderStates.m_depthStencilState.m_stencil;
-            stencilState.m_enable = true;
-            stencilState.m_frontFace.m_failOp = AZ::RHI::StencilOp::Keep;
-            stencilState.m_frontFace.m_passOp = AZ::RHI::StencilOp::Keep;
-            stencilState.m_frontFace.m_depthFailOp = AZ::RHI::StencilOp::Keep;
-            stencilState.m_frontFace.m_func = AZ::RHI::ComparisonFunc::Equal;
-            stencilState.m_writeMask = 0xFF;
-            stencilState.m_readMask = 0xFF;
-
-            stencilState.m_backFace = stencilState.m_frontFace;
-
-            StandardPipelineStateFinish(states.standardStencilTest);
-
-            states.standardStencilTest->GetRHIPipelineState()->GetDevicePipelineState(0)->SetName(
-                AZ::Name("TuRml Standard StandardStencilTest"));
+            ++m_reusedFrameCount;
         }
-
-        if (states.CMO_Set == nullptr)
+        else
         {
-            StandardPipelineStateInit(states.CMO_Set);
-
-            AZ::RHI::RenderStates& renderStates = states.CMO_Set->RenderStatesOverlay();
-            renderStates.m_depthStencilState.m_depth.m_enable = false;
-            auto& stencilState = renderStates.m_depthStencilState.m_stencil;
-            stencilState.m_enable = true;
-            stencilState.m_frontFace.m_failOp = AZ::RHI::StencilOp::Keep;
-            stencilState.m_frontFace.m_passOp = AZ::RHI::StencilOp::Replace;
-            stencilState.m_frontFace.m_depthFailOp = AZ::RHI::StencilOp::Keep;
-            stencilState.m_frontFace.m_func = AZ::RHI::ComparisonFunc::Always;
-            stencilState.m_writeMask = 0xFF;
-            stencilState.m_readMask = 0xFF;
-
-            stencilState.m_backFace = stencilState.m_frontFace;
+            const AZ::u8 previousIndex = m_drawCommands.m_currentIndex;
+            m_drawCommands.NextBuffer(TuRmlRenderInterface::GetFramesInFlight());
 
-            AZ::RHI::TargetBlendState& blendState = renderStates.m_blendState.m_targets[0];
-            blendState.m_writeMask = 0; //No Color output
-
-            StandardPipelineStateFinish(states.CMO_Set);
+            TuRmlContextRenderInterface& contextInterface = renderInterface->GetContextRenderInterface(m_rmlContext);
+            contextInterface.Begin(m_rmlContext, this);
+            {
+                AZ_PROFILE_SCOPE(RmlBudget, "Rml::Context::Render");
+                // Other draw list jobs may be rendering too, only End() below runs alongside them
+                AZStd::lock_guard<AZStd::mutex> lock(renderInterface->m_rmlRenderMutex);
+                m_rmlContext->Render();
+            }
+            contextInterface.End();
 
-            states.CMO_Set->GetRHIPipelineState()->GetDevicePipelineState(0)->SetName(
-                AZ::Name("TuRml Standard CMO_Set"));
+            // The render target still shows the previous draw list, textures it used must look the same
+            const FrameInfo& previousFrame = m_drawCommands.Get(previousIndex);
+            if (r_rmlDamageTracking && m_attachmentImage && m_renderTargetValid &&
+                previousFrame.textureGeneration == renderInterface->GetTextureGeneration())
+            {
+                UpdateDamage(previousFrame, m_drawCommands.Get());
+            }
         }
 
-        if (states.CMO_Intersect == nullptr)
-        {
-            StandardPipelineStateInit(states.CMO_Intersect);
-
-            AZ::RHI::RenderStates& renderStates = states.CMO_Intersect->RenderStatesOverlay();
-            renderStates.m_depthStencilState.m_depth.m_enable = false;
-            auto& stencilState = renderStates.m_depthStencilState.m_stencil;
-            stencilState.m_enable = true;
-            stencilState.m_frontFace.m_failOp = AZ::RHI::StencilOp::Keep;
-            stencilState.m_frontFace.m_passOp = AZ::RHI::StencilOp::IncrementSaturate;
-            stencilState.m_frontFace.m_depthFailOp = AZ::RHI::StencilOp::Keep;
-            stencilState.m_frontFace.m_func = AZ::RHI::ComparisonFunc::Always;
-            stencilState.m_writeMask = 0xFF;
-            stencilState.m_readMask = 0xFF;
-
-            stencilState.m_backFace = stencilState.m_frontFace;
-
-            AZ::RHI::TargetBlendState& blendState = renderStates.m_blendState.m_targets[0];
-            blendState.m_writeMask = 0; //No Color output
-
-            StandardPipelineStateFinish(states.CMO_Intersect);
-
-            states.CMO_Intersect->GetRHIPipelineState()->GetDevicePipelineState(0)->SetName(
-                AZ::Name("TuRml Standard CMO_Intersect"));
-        }
+        // Holds a complete frame once this one is drawn
+        m_renderTargetValid = m_attachmentImage != nullptr;
     }
 
-    void TuRmlChildPass::CompileResources(const AZ::RHI::FrameGraphCompileContext& context)
+    void TuRmlChildPass::UpdateDamage(const FrameInfo& previousFrame, const FrameInfo& currentFrame)
     {
         AZ_PROFILE_FUNCTION(RmlBudget);
-        RasterPass::CompileResources(context);
+        const auto& previousCmds = previousFrame.drawCmds;
+        const auto& currentCmds = currentFrame.drawCmds;
+
+        // Changes are usually local, everything before the first and after the last changed draw is the same
+        const size_t commonCount = AZStd::min(previousCmds.size(), currentCmds.size());
+        size_t prefix = 0;
+        while (prefix < commonCount &&
+               IsSameDraw(previousFrame, previousCmds[prefix], currentFrame, currentCmds[prefix]))
+        {
+            ++prefix;
+        }
+        size_t suffix = 0;
+        while (suffix < commonCount - prefix &&
+               IsSameDraw(previousFrame, previousCmds[previousCmds.size() - 1 - suffix],
+                          currentFrame, currentCmds[currentCmds.size() - 1 - suffix]))
+        {
+            ++suffix;
+        }
 
-        // Load the UIElement shader if we haven't already
-        if (!m_shader)
+        // Whatever the removed draws covered has to be redrawn as well as what the added ones cover
+        bool hasDamage = false;
+        Rml::Rectanglef damage;
+        const auto addDamage = [&hasDamage, &damage](const TuRmlChildPassDrawCommand& cmd)
         {
-            const char* shaderFilePath = "Shaders/TuRml/UIElement.azshader";
-            m_shader = AZ::RPI::LoadCriticalShader(shaderFilePath);
-            if (!m_shader)
+            if (cmd.drawCommand.drawType == TuRmlDrawCommand::DrawType::ClearClipmask)
             {
-                AZ_Error("TuRmlChildPass", false, "Failed to load UIElement shader: %s", shaderFilePath);
                 return;
             }
-            m_srgRecycler = AZStd::make_unique<SrgRecycler>(m_shader);
-            AZ_Info("TuRmlChildPass", "Successfully loaded UIElement shader");
+            damage = hasDamage ? damage.Join(cmd.drawCommand.bounds) : cmd.drawCommand.bounds;
+            hasDamage = true;
+        };
+        for (size_t i = prefix; i < previousCmds.size() - suffix; ++i)
+        {
+            addDamage(previousCmds[i]);
         }
-
-        //Ensure our standard shader set exists.
-        CreatePipelineStates(m_standard, m_shader);
-
-        if (!m_clearShader)
+        for (size_t i = prefix; i < currentCmds.size() - suffix; ++i)
         {
-            const char* clearShaderPath = "Shaders/TuRml/ClearStencil.azshader";
-            m_clearShader = AZ::RPI::LoadCriticalShader(clearShaderPath);
-            if (!m_clearShader)
-            {
-                AZ_Error("TuRmlChildPass", false, "Failed to load clear stencil shader: %s", clearShaderPath);
-            }
-            else
-            {
-                AZ_Info("TuRmlChildPass", "Successfully loaded clear stencil shader");
-            }
+            addDamage(currentCmds[i]);
         }
 
-        if (m_clearShader && !m_clearStencilPipelineState)
+        // Rounded out with a pixel of margin for filtering, clamped to the image
+        const auto imageSize = m_attachmentImage->GetDescriptor().m_size;
+        const int width = static_cast<int>(imageSize.m_width);
+        const int height = static_cast<int>(imageSize.m_height);
+        m_damageRect = Rml::Rectanglei();
+        if (hasDamage)
         {
-            m_clearStencilPipelineState = aznew AZ::RPI::PipelineStateForDraw;
-            m_clearStencilPipelineState->Init(m_clearShader);
-
-            AZ::RHI::InputStreamLayoutBuilder layoutBuilder;
-            // Fullscreen triangle generated in vertex shader
-            m_clearStencilPipelineState->InputStreamLayout() = layoutBuilder.End();
-
-            AZ::RHI::RenderStates& renderStates = m_clearStencilPipelineState->RenderStatesOverlay();
-
-            renderStates.m_depthStencilState.m_depth.m_enable = false;
-
-            auto& stencilState = renderStates.m_depthStencilState.m_stencil;
-            stencilState.m_enable = true;
-            stencilState.m_frontFace.m_failOp = AZ::RHI::StencilOp::Replace;
-            stencilState.m_frontFace.m_passOp = AZ::RHI::StencilOp::Replace;
-            stencilState.m_frontFace.m_depthFailOp = AZ::RHI::StencilOp::Replace;
-            stencilState.m_frontFace.m_func = AZ::RHI::ComparisonFunc::Always;
-            stencilState.m_writeMask = 0xFF;
-            stencilState.m_readMask = 0xFF;
-            stencilState.m_backFace = stencilState.m_frontFace;
-
-            AZ::RHI::TargetBlendState& blendState = renderStates.m_blendState.m_targets[0];
-            blendState.m_writeMask = 0;
-
-            m_clearStencilPipelineState->SetOutputFromPass(this);
-            m_clearStencilPipelineState->Finalize();
-
-            AZ_Info("TuRmlChildPass", "Created clear stencil pipeline state");
+            m_damageRect = Rml::Rectanglei::FromCorners(
+                Rml::Vector2i(AZStd::clamp(static_cast<int>(AZStd::floor(damage.p0.x)) - 1, 0, width),
+                              AZStd::clamp(static_cast<int>(AZStd::floor(damage.p0.y)) - 1, 0, height)),
+                Rml::Vector2i(AZStd::clamp(static_cast<int>(AZStd::ceil(damage.p1.x)) + 1, 0, width),
+                              AZStd::clamp(static_cast<int>(AZStd::ceil(damage.p1.y)) + 1, 0, height)));
         }
 
-        // Compile SRGs for all draw commands that don't have them yet
-        if (!m_shader || m_rmlContext == nullptr)
-            return;
+        m_partialRedraw = true;
+        ++m_partialRedrawCount;
+        const int damageArea = AZStd::max(m_damageRect.Width(), 0) * AZStd::max(m_damageRect.Height(), 0);
+        m_damageCoverage = width > 0 && height > 0 ?
+            static_cast<float>(damageArea) / static_cast<float>(width * height) : 0.0f;
+    }
+
+    void TuRmlChildPass::CompileResources(const AZ::RHI::FrameGraphCompileContext& context)
+    {
+        AZ_PROFILE_FUNCTION(RmlBudget);
+        RasterPass::CompileResources(context);
 
         TuRmlRenderInterface* renderInterface = nullptr;
         TuRmlRequestBus::BroadcastResult(renderInterface, &TuRmlRequestBus::Events::GetRenderInterface);
         if (renderInterface == nullptr)
             return;
 
+        // Passes rendering to the same output share their pipeline states, the first one builds them
+        if (!m_pipelineStates.standard.standard)
+        {
+            TuRmlPipelineStateCache& pipelineStateCache = renderInterface->GetPipelineStateCache();
+            if (!pipelineStateCache.Acquire(this, m_pipelineStates))
+                return;
+            m_shader = pipelineStateCache.GetShader();
+        }
+
+        // Write the per-draw constants for this frame, a reused frame still has them from when it was recorded
+        if (!m_shader || m_rmlContext == nullptr || m_reusedFrame)
+            return;
+
         {
             AZ_PROFILE_SCOPE(RmlBudget, "Process DrawCommands");
-            auto& drawCommands = m_drawCommands.Get().drawCmds;
-            for (auto& childPassCmd : drawCommands)
+            auto& frameInfo = m_drawCommands.Get();
+            auto& drawCmds = frameInfo.drawCmds;
+            auto& drawConstants = frameInfo.m_drawConstants;
+            const auto& instanceTranslations = frameInfo.instanceTranslations;
+
+            // Slots are handed out up front so chunks don't depend on each other, instanced draws take one per
+            // instance. Slots of clear commands stay unused.
+            const size_t drawCount = drawCmds.size();
+            uint32_t slotCount = 0;
+            for (auto& childPassCmd : drawCmds)
             {
-                const bool needSRG = childPassCmd.drawCommand.drawType != TuRmlDrawCommand::DrawType::ClearClipmask;
+                childPassCmd.drawConstantsIndex = slotCount;
+                slotCount += childPassCmd.instanceCount;
+            }
+            drawConstants.resize(slotCount);
 
-                if (needSRG && !childPassCmd.srgReady && !childPassCmd.drawSrg)
+            // Texture srgs and UV rects were resolved in End(), together with the atlas UVs baked into batches
+            const auto prepareRange = [&drawCmds, &drawConstants, &instanceTranslations](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
                 {
-                    childPassCmd.drawSrg = m_srgRecycler->GetSrg();
+                    auto& childPassCmd = drawCmds[i];
+                    const TuRmlDrawCommand& cmd = childPassCmd.drawCommand;
+                    if (cmd.drawType == TuRmlDrawCommand::DrawType::ClearClipmask)
+                    {
+                        continue;
+                    }
+
+                    TuRmlDrawConstants& constants = drawConstants[childPassCmd.drawConstantsIndex];
+                    cmd.transform.StoreToRowMajorFloat16(constants.m_transform);
+                    cmd.translation.StoreToFloat2(constants.m_translate);
+                    constants.m_hasTexture = cmd.texture != 0 ? 1 : 0;
+
+                    // Batches already have the atlas UVs baked into their vertices
+                    const AZ::Vector4 uvRect = childPassCmd.batchIndex >= 0 ?
+                        AZ::Vector4(0.0f, 0.0f, 1.0f, 1.0f) : cmd.uvRect;
+                    uvRect.StoreToFloat4(constants.m_uvRect);
 
-                    if (childPassCmd.drawSrg)
+                    // Instances only differ in their translation
+                    for (uint32_t instance = 1; instance < childPassCmd.instanceCount; ++instance)
                     {
-                        // Find shader input indices
-                        auto transformIndex = childPassCmd.drawSrg->m_srg->FindShaderInputConstantIndex(
-                            AZ::Name("m_transform"));
-                        auto translateIndex = childPassCmd.drawSrg->m_srg->FindShaderInputConstantIndex(
-                            AZ::Name("m_translate"));
-                        auto hasTextureIndex = childPassCmd.drawSrg->m_srg->FindShaderInputConstantIndex(
-                            AZ::Name("m_hasTexture"));
-                        auto textureIndex = childPassCmd.drawSrg->m_srg->FindShaderInputImageIndex(
-                            AZ::Name("m_texture"));
-
-                        if (transformIndex.IsValid())
-                        {
-                            childPassCmd.drawSrg->m_srg->
-                                         SetConstant(transformIndex, childPassCmd.drawCommand.transform);
-                        }
-
-                        if (translateIndex.IsValid())
-                        {
-                            childPassCmd.drawSrg->m_srg->SetConstant(translateIndex,
-                                                                     childPassCmd.drawCommand.translation);
-                        }
-
-                        bool hasTexture = childPassCmd.drawCommand.texture != 0;
-                        if (hasTextureIndex.IsValid())
-                        {
-                            childPassCmd.drawSrg->m_srg->SetConstant(hasTextureIndex, hasTexture);
-                        }
-
-                        if (hasTexture && textureIndex.IsValid())
-                        {
-                            if (auto storedTex = renderInterface->
-                                GetStoredTexture(childPassCmd.drawCommand.texture))
-                            {
-                                if (storedTex->streamingImage)
-                                {
-                                    childPassCmd.drawSrg->m_srg->SetImage(textureIndex, storedTex->streamingImage);
-                                }
-                            }
-                        }
-                        childPassCmd.drawSrg->m_srg->Compile();
-                        childPassCmd.srgReady = true;
+                        const uint32_t slot = childPassCmd.drawConstantsIndex + instance;
+                        TuRmlDrawConstants& instanceConstants = drawConstants[slot];
+                        instanceConstants = constants;
+                        instanceTranslations[childPassCmd.firstInstance + instance].StoreToFloat2(
+                            instanceConstants.m_translate);
                     }
                 }
+            };
+
+            const int parallelThreshold = r_rmlParallelDrawPrepThreshold;
+            if (parallelThreshold <= 0 || drawCount < static_cast<size_t>(parallelThreshold))
+            {
+                prepareRange(0, drawCount);
+            }
+            else
+            {
+                const int chunkSizeCvar = r_rmlParallelDrawPrepChunkSize;
+                const size_t chunkSize = static_cast<size_t>(AZStd::max(chunkSizeCvar, 1));
+                const size_t chunkCount = (drawCount + chunkSize - 1) / chunkSize;
+                AZ::parallel_for(size_t(0), chunkCount, [&prepareRange, chunkSize, drawCount](size_t chunk)
+                {
+                    prepareRange(chunk * chunkSize, AZStd::min(drawCount, (chunk + 1) * chunkSize));
+                });
+            }
+
+            if (!drawConstants.empty())
+            {
+                frameInfo.EnsureDrawConstantsCapacity(drawConstants.size(), m_shader);
+                if (frameInfo.m_drawConstantsBuffer)
+                {
+                    frameInfo.m_drawConstantsBuffer->UpdateData(
+                        drawConstants.data(), drawConstants.size() * sizeof(TuRmlDrawConstants), 0);
+                }
             }
         }
     }
@@ -461,10 +502,11 @@ namespace TuRml
         AZ_PROFILE_FUNCTION(RmlBudget);
         RasterPass::BuildCommandListInternal(context);
         auto tuRmlInterface = TuRmlInterface::Get();
-        auto& drawCommands = m_drawCommands.Get().drawCmds;
-        m_submittedIdx =  m_drawCommands.m_currentIndex;
+        auto& frameInfo = m_drawCommands.Get();
+        auto& drawCommands = frameInfo.drawCmds;
 
-        if (tuRmlInterface == nullptr || !m_shader || !m_shader->GetAsset() || drawCommands.empty())
+        if (tuRmlInterface == nullptr || !m_shader || !m_shader->GetAsset() || drawCommands.empty() ||
+            !frameInfo.m_drawSrg)
         {
             return;
         }
@@ -475,48 +517,72 @@ namespace TuRml
             return;
         }
 
+        // Nothing changed since the contents the render target still holds
+        if (m_partialRedraw && (m_damageRect.Width() <= 0 || m_damageRect.Height() <= 0))
+        {
+            return;
+        }
+        const Rml::Rectanglef damage = Rml::Rectanglef::FromCorners(
+            Rml::Vector2f(static_cast<float>(m_damageRect.p0.x), static_cast<float>(m_damageRect.p0.y)),
+            Rml::Vector2f(static_cast<float>(m_damageRect.p1.x), static_cast<float>(m_damageRect.p1.y)));
+
         auto* commandList = context.GetCommandList();
+        commandList->SetShaderResourceGroupForDraw(
+            *frameInfo.m_drawSrg->GetRHIShaderResourceGroup()->GetDeviceShaderResourceGroup(context.GetDeviceIndex()));
+        const AZ::RPI::ShaderResourceGroup* boundTextureSrg = nullptr;
+
+        // Removed draws and whatever the redrawn ones blend over must not show through, ahead of the first draw
+        if (m_partialRedraw && context.GetSubmitRange().m_startIndex == 0)
+        {
+            SubmitFullscreenTriangle(context, *m_pipelineStates.clearColor, m_damageRect, 0);
+        }
+
         for (size_t drawIndex = context.GetSubmitRange().m_startIndex; drawIndex < context.GetSubmitRange().m_endIndex;
              ++drawIndex)
         {
             auto& drawCmd = drawCommands[drawIndex];
             if (drawCmd.drawCommand.drawType == TuRmlDrawCommand::DrawType::ClearClipmask)
             {
-                // Clear stencil buffer using fullscreen triangle
-                if (m_clearStencilPipelineState)
+                // Clear stencil buffer using fullscreen triangle, scissored to the area the masks were written in
+                Rml::Rectanglei clearRegion = drawCmd.drawCommand.scissorRegion;
+                if (m_partialRedraw)
                 {
-                    AZ::RHI::DeviceDrawItem clearItem;
-                    clearItem.m_drawInstanceArgs = AZ::RHI::DrawInstanceArguments(1, 0);
-
-                    // Create empty geometry view for fullscreen triangle (generated in vertex shader)
-                    AZ::RHI::GeometryView geometryView{AZ::RHI::MultiDevice::AllDevices};
-                    geometryView.SetDrawArguments(AZ::RHI::DrawLinear(3, 0)); // 3 vertices for fullscreen triangle
-                    clearItem.m_geometryView = geometryView.GetDeviceGeometryView(context.GetDeviceIndex());
-                    clearItem.m_streamIndices = geometryView.GetFullStreamBufferIndices();
-
-                    clearItem.m_pipelineState = m_clearStencilPipelineState->GetRHIPipelineState()->
-                                                                             GetDevicePipelineState(
-                                                                                 context.GetDeviceIndex()).get();
-                    clearItem.m_stencilRef = 0; // Clear stencil to 0
-                    clearItem.m_scissorsCount = 0;
-                    clearItem.m_scissors = nullptr;
-
-                    commandList->Submit(clearItem, static_cast<uint32_t>(drawIndex));
+                    clearRegion = clearRegion == Rml::Rectanglei() ? m_damageRect : Rml::Rectanglei::FromCorners(
+                        Rml::Vector2i(AZStd::max(clearRegion.p0.x, m_damageRect.p0.x),
+                                      AZStd::max(clearRegion.p0.y, m_damageRect.p0.y)),
+                        Rml::Vector2i(AZStd::min(clearRegion.p1.x, m_damageRect.p1.x),
+                                      AZStd::min(clearRegion.p1.y, m_damageRect.p1.y)));
+                    if (clearRegion.p1.x <= clearRegion.p0.x || clearRegion.p1.y <= clearRegion.p0.y)
+                    {
+                        continue;
+                    }
+                }
+                if (m_pipelineStates.clearStencil)
+                {
+                    SubmitFullscreenTriangle(context, *m_pipelineStates.clearStencil, clearRegion,
+                                             static_cast<uint32_t>(drawIndex));
                 }
                 continue;
             }
 
-            // Get the stored geometry
-            if (auto storedGeo = renderInterface->GetStoredGeometry(drawCmd.drawCommand.geometryHandle))
+            // Draws away from the damage already show up correctly in the render target
+            if (m_partialRedraw && !drawCmd.drawCommand.bounds.Intersects(damage))
+            {
+                continue;
+            }
+
+            // Views were resolved from the stored geometry or batch in AllocateGPUBuffers
+            if (drawCmd.indexCount > 0)
             {
+                PipelineStates& states = drawCmd.compactVertices ? m_pipelineStates.compact : m_pipelineStates.standard;
+
                 AZ::RHI::DeviceDrawItem drawItem;
-                drawItem.m_drawInstanceArgs = AZ::RHI::DrawInstanceArguments(1, 0);
+                drawItem.m_drawInstanceArgs = AZ::RHI::DrawInstanceArguments(drawCmd.instanceCount, 0);
 
                 AZ::RHI::GeometryView geometryView{AZ::RHI::MultiDevice::AllDevices};
-                geometryView.SetDrawArguments(
-                    AZ::RHI::DrawIndexed(0, static_cast<uint32_t>(storedGeo->indexCount), 0));
-                geometryView.SetIndexBufferView(storedGeo->indexBufferView);
-                geometryView.AddStreamBufferView(storedGeo->vertexBufferView);
+                geometryView.SetDrawArguments(AZ::RHI::DrawIndexed(0, drawCmd.indexCount, 0));
+                geometryView.SetIndexBufferView(drawCmd.indexBufferView);
+                geometryView.AddStreamBufferView(drawCmd.vertexBufferView);
 
                 drawItem.m_geometryView = geometryView.GetDeviceGeometryView(context.GetDeviceIndex());
                 drawItem.m_streamIndices = geometryView.GetFullStreamBufferIndices();
@@ -525,13 +591,13 @@ namespace TuRml
                 {
                     if (drawCmd.drawCommand.clipmaskEnabled)
                     {
-                        drawItem.m_pipelineState = m_standard.standardStencilTest->GetRHIPipelineState()->
+                        drawItem.m_pipelineState = states.standardStencilTest->GetRHIPipelineState()->
                                                               GetDevicePipelineState(context.GetDeviceIndex()).
                                                               get();
                     }
                     else
                     {
-                        drawItem.m_pipelineState = m_standard.standard->GetRHIPipelineState()->
+                        drawItem.m_pipelineState = states.standard->GetRHIPipelineState()->
                                                               GetDevicePipelineState(context.GetDeviceIndex()).
                                                               get();
                     }
@@ -540,7 +606,7 @@ namespace TuRml
                 {
                     //clipmask
                     drawItem.m_pipelineState =
-                        m_standard.GetPipelineStateForClipMaskOp(drawCmd.drawCommand.clipmask_op)
+                        states.GetPipelineStateForClipMaskOp(drawCmd.drawCommand.clipmask_op)
                                   ->GetRHIPipelineState()->GetDevicePipelineState(context.GetDeviceIndex()).get();
                 }
 
@@ -550,9 +616,18 @@ namespace TuRml
 
                 AZ::RHI::Scissor scissor;
 
-                if (drawCmd.drawCommand.scissorRegion != Rml::Rectanglei())
+                if (drawCmd.drawCommand.scissorRegion != Rml::Rectanglei() || m_partialRedraw)
                 {
-                    const auto scissorRegion = drawCmd.drawCommand.scissorRegion;
+                    auto scissorRegion = drawCmd.drawCommand.scissorRegion;
+                    if (m_partialRedraw)
+                    {
+                        scissorRegion = scissorRegion == Rml::Rectanglei() ?
+                            m_damageRect : Rml::Rectanglei::FromCorners(
+                                Rml::Vector2i(AZStd::max(scissorRegion.p0.x, m_damageRect.p0.x),
+                                              AZStd::max(scissorRegion.p0.y, m_damageRect.p0.y)),
+                                Rml::Vector2i(AZStd::min(scissorRegion.p1.x, m_damageRect.p1.x),
+                                              AZStd::min(scissorRegion.p1.y, m_damageRect.p1.y)));
+                    }
                     scissor = AZ::RHI::Scissor(
                         scissorRegion.p0.x,
                         scissorRegion.p0.y,
@@ -563,40 +638,61 @@ namespace TuRml
                     drawItem.m_scissors = &scissor;
                 }
 
-                commandList->SetShaderResourceGroupForDraw(
-                    *drawCmd.drawSrg->m_srg->GetRHIShaderResourceGroup()->GetDeviceShaderResourceGroup(
-                        context.GetDeviceIndex()));
+                drawItem.m_rootConstantSize = sizeof(drawCmd.drawConstantsIndex);
+                drawItem.m_rootConstants = reinterpret_cast<const uint8_t*>(&drawCmd.drawConstantsIndex);
+
+                if (drawCmd.textureSrg && drawCmd.textureSrg != boundTextureSrg)
+                {
+                    commandList->SetShaderResourceGroupForDraw(
+                        *drawCmd.textureSrg->GetRHIShaderResourceGroup()->GetDeviceShaderResourceGroup(
+                            context.GetDeviceIndex()));
+                    boundTextureSrg = drawCmd.textureSrg;
+                }
 
                 commandList->Submit(drawItem, static_cast<uint32_t>(drawIndex));
             }
         }
     }
 
-    void TuRmlChildPass::FrameEndInternal()
+    void TuRmlChildPass::SubmitFullscreenTriangle(const AZ::RHI::FrameGraphExecuteContext& context,
+                                                  const AZ::RPI::PipelineStateForDraw& pipelineState,
+                                                  const Rml::Rectanglei& region, uint32_t submitIndex)
     {
-        RasterPass::FrameEndInternal();
-        auto& commands = m_drawCommands.Get(m_submittedIdx);
-        for (auto& command : commands.drawCmds)
+        AZ::RHI::DeviceDrawItem drawItem;
+        drawItem.m_drawInstanceArgs = AZ::RHI::DrawInstanceArguments(1, 0);
+
+        // Create empty geometry view for fullscreen triangle (generated in vertex shader)
+        AZ::RHI::GeometryView geometryView{AZ::RHI::MultiDevice::AllDevices};
+        geometryView.SetDrawArguments(AZ::RHI::DrawLinear(3, 0)); // 3 vertices for fullscreen triangle
+        drawItem.m_geometryView = geometryView.GetDeviceGeometryView(context.GetDeviceIndex());
+        drawItem.m_streamIndices = geometryView.GetFullStreamBufferIndices();
+
+        drawItem.m_pipelineState = pipelineState.GetRHIPipelineState()->GetDevicePipelineState(
+            context.GetDeviceIndex()).get();
+        drawItem.m_stencilRef = 0; // Pipeline states writing stencil clear it to 0
+        drawItem.m_scissorsCount = 0;
+        drawItem.m_scissors = nullptr;
+
+        AZ::RHI::Scissor scissor;
+        if (region != Rml::Rectanglei())
         {
-            if (!command.drawSrg)
-            {
-                continue;
-            }
-
-            m_srgRecycler->FreeSrg(command.drawSrg);
+            scissor = AZ::RHI::Scissor(region.p0.x, region.p0.y, region.p1.x, region.p1.y);
+            drawItem.m_scissorsCount = 1;
+            drawItem.m_scissors = &scissor;
         }
 
+        context.GetCommandList()->Submit(drawItem, submitIndex);
+    }
+
+    void TuRmlChildPass::FrameEndInternal()
+    {
+        RasterPass::FrameEndInternal();
+
         TuRmlRenderInterface* renderInterface = nullptr;
         TuRmlRequestBus::BroadcastResult(renderInterface, &TuRmlRequestBus::Events::GetRenderInterface);
         if (renderInterface == nullptr)
             return;
 
-        for (auto& geo : commands.queuedFreeGeos)
-        {
-            TuRmlStoredGeometry::ReleaseGeometry(geo);
-        }
-        commands.queuedFreeGeos.clear();
-
-        renderInterface->OnFinishedFrame(this, m_submittedIdx);
+        renderInterface->OnFinishedFrame();
     }
 }
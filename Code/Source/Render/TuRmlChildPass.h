@@ -10,6 +10,7 @@
 #include <Atom/RPI.Public/Pass/RasterPass.h>
 #include <Atom/RPI.Public/Image/AttachmentImage.h>
 #include <Atom/RPI.Public/PipelineState.h>
+#include <Atom/RPI.Public/Shader/ShaderResourceGroup.h>
 
 #include "TuRmlRenderInterface.h"
 
@@ -20,84 +21,112 @@ namespace Rml
 
 namespace TuRml
 {
-    class SrgRecycler
+    //! Per-draw shader constants, stored in one structured buffer per frame and indexed by a root constant.
+    //! Layout must match DrawConstants in UIElement.azsl.
+    struct TuRmlDrawConstants
     {
-    public:
-        SrgRecycler(const AZ::Data::Instance<AZ::RPI::Shader>& shader);
-        struct Srg
-        {
-            AZ::Data::Instance<AZ::RPI::ShaderResourceGroup> m_srg;
-            bool inUse = false;
-        };
-
-        Srg* GetSrg();
-        void FreeSrg(Srg* srg);
-
-    private:
-        AZ::Data::Instance<AZ::RPI::Shader> m_shader = {};
-        AZStd::vector<AZStd::unique_ptr<Srg>> m_srgs = {};
-        AZStd::mutex m_mutex;
+        float m_transform[16];
+        float m_translate[2];
+        uint32_t m_hasTexture = 0;
+        uint32_t m_padding = 0;
+        //! Offset in xy and scale in zw, remaps UVs of atlased textures into their page.
+        float m_uvRect[4];
     };
+    static_assert(sizeof(TuRmlDrawConstants) == 96, "TuRmlDrawConstants must match the shader layout");
 
     struct TuRmlChildPassDrawCommand
     {
         TuRmlDrawCommand drawCommand = {};
-        SrgRecycler::Srg* drawSrg = nullptr;
-        bool srgReady = false;
+        //! Index into the frame's draw constants buffer, passed to the shader as a root constant.
+        //! Instances use consecutive slots from here, the shader adds the instance id.
+        uint32_t drawConstantsIndex = 0;
+        //! Draws of the same geometry folded into one instanced draw, translations are in
+        //! FrameInfo::instanceTranslations starting at firstInstance.
+        uint32_t instanceCount = 1;
+        uint32_t firstInstance = 0;
+        //! Cached per texture by the render interface, resolved in End() along with the draw's UV rect.
+        AZ::RPI::ShaderResourceGroup* textureSrg = nullptr;
+
+        //! Index into FrameInfo::batches if this command draws several merged geometries, -1 otherwise.
+        int32_t batchIndex = -1;
+        //! Vertices are TuRmlCompactVertex, drawn with the compact pipeline states.
+        bool compactVertices = false;
+
+        // Resolved in AllocateGPUBuffers, either from the stored geometry or from the batch.
+        AZ::RHI::StreamBufferView vertexBufferView = {};
+        AZ::RHI::IndexBufferView indexBufferView = {};
+        uint32_t indexCount = 0;
+    };
+
+    //! Consecutive draw commands sharing the same state, merged into one indexed draw.
+    //! Translations are baked into the vertices written to the pass's transient ring.
+    struct TuRmlDrawBatch
+    {
+        // Range in FrameInfo::batchSources
+        size_t firstSource = 0;
+        size_t sourceCount = 0;
+
+        size_t vertexCount = 0;
+        size_t indexCount = 0;
+        TuRmlVertexFormat format;
+        TuRmlRingBuffer::Allocation vertexAllocation = {};
+        TuRmlRingBuffer::Allocation indexAllocation = {};
     };
 
     struct FrameInfo
     {
         AZStd::vector<TuRmlChildPassDrawCommand> drawCmds;
-        //Geo's to free from this frame
+        //Geo's released while this frame was current, the render interface's release queue frees them
         AZStd::vector<Rml::CompiledGeometryHandle> queuedFreeGeos = {};
 
-        // Shared dynamic buffers for transient geometry
-        AZ::Data::Instance<AZ::RPI::Buffer> m_sharedVertexBuffer;
-        AZ::Data::Instance<AZ::RPI::Buffer> m_sharedIndexBuffer;
-        size_t m_sharedVertexCapacity = 0;
-        size_t m_sharedIndexCapacity = 0;
-
-        void EnsureTransientBufferCapacity(size_t vertexCount, size_t indexCount);
+        AZStd::vector<TuRmlDrawBatch> batches;
+        //Original draw commands that were merged into batches
+        AZStd::vector<TuRmlDrawCommand> batchSources;
+        //Translations of instanced draws
+        AZStd::vector<AZ::Vector2> instanceTranslations;
+        //Draw command count before batching, for stats
+        size_t originalDrawCount = 0;
+        size_t instancedDrawCount = 0;
+        //Draws RenderGeometry dropped because they can't produce any pixels
+        size_t culledDrawCount = 0;
+        //Rectangular clip masks applied as a scissor rectangle instead of through the stencil buffer
+        size_t scissorClipMaskCount = 0;
+        //Stencil clears submitted, clip masks that didn't need one and the pixels the clears covered
+        size_t stencilClearCount = 0;
+        size_t stencilClearsSkipped = 0;
+        size_t stencilClearArea = 0;
+        //Texture or pipeline state changes between consecutive draws that reordering avoided
+        size_t reorderStateChangesSaved = 0;
+
+        // Set in End() if nothing in the draw list is freed at the end of the frame, so it can be submitted again
+        bool retainable = false;
+        // Render interface texture generation the texture srgs were resolved at
+        AZ::u64 textureGeneration = 0;
+        // Render interface geometry generation when the draw list was recorded
+        AZ::u64 geometryGeneration = 0;
+
+        // Per-draw constants for this frame, bound once through m_drawSrg
+        AZStd::vector<TuRmlDrawConstants> m_drawConstants;
+        AZ::Data::Instance<AZ::RPI::Buffer> m_drawConstantsBuffer;
+        AZ::Data::Instance<AZ::RPI::ShaderResourceGroup> m_drawSrg;
+        size_t m_drawConstantsCapacity = 0;
+
+        void EnsureDrawConstantsCapacity(size_t drawCount, const AZ::Data::Instance<AZ::RPI::Shader>& shader);
     };
 
+    //! One frame info per frame in flight, a frame's draw constants aren't overwritten while the GPU reads them
     struct BufferedTuRmlDrawCommands
     {
-        static constexpr AZ::u32 DrawCommandBuffering = 2;
-        AZStd::array<FrameInfo, DrawCommandBuffering> m_drawCommands;
+        static constexpr AZ::u32 MaxDrawCommandBuffering = TuRmlRingBuffer::MaxFramesInFlight;
+        AZStd::array<FrameInfo, MaxDrawCommandBuffering> m_drawCommands;
         AZ::u8 m_currentIndex = 0;
 
-        void NextBuffer() { m_currentIndex = (m_currentIndex + 1) % DrawCommandBuffering; }
+        void NextBuffer(AZ::u32 buffering) { m_currentIndex = static_cast<AZ::u8>((m_currentIndex + 1) % buffering); }
 
         FrameInfo& Get() { return m_drawCommands[m_currentIndex]; }
         FrameInfo& Get(AZ::u8 idx) { return m_drawCommands[idx]; }
     };
 
-    struct PipelineStates
-    {
-        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> standard;
-        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> standardStencilTest;
-        //The following pipeline states are for Rml::ClipMaskOperation
-        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> CMO_Set;
-        //For SetInverse use Set
-        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> CMO_Intersect;
-
-        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> GetPipelineStateForClipMaskOp(
-            const Rml::ClipMaskOperation operation)
-        {
-            switch (operation)
-            {
-            case Rml::ClipMaskOperation::SetInverse:
-            case Rml::ClipMaskOperation::Set:
-                return CMO_Set;
-            case Rml::ClipMaskOperation::Intersect:
-                return CMO_Intersect;
-            default:
-                return standard;
-            }
-        }
-    };
-
     //! Child pass that can render RmlUi either to a specific render target or directly to the main pipeline
     class TuRmlChildPass final
         : public AZ::RPI::RasterPass
@@ -111,12 +140,24 @@ namespace TuRml
         ~TuRmlChildPass() override = default;
         static AZ::RPI::Ptr<TuRmlChildPass> Create(const AZ::RPI::PassDescriptor& descriptor);
 
-        void UpdateRenderTarget(AZ::Data::Instance<AZ::RPI::AttachmentImage> attachmentImage);
+        //! The depth stencil image is only given for templates with a DepthStencilOutput slot, the multisampled
+        //! direct pipeline one. The default template has no stencil to clip with.
+        void UpdateRenderTarget(AZ::Data::Instance<AZ::RPI::AttachmentImage> attachmentImage,
+                                AZ::Data::Instance<AZ::RPI::AttachmentImage> depthStencilImage = nullptr);
         void SetRmlContext(Rml::Context* context);
 
         //! Set the pass to render directly to the main pipeline (no specific render target
         void SetDirectPipelineMode();
 
+        //! Picks up whether the context changed, called once per frame before the passes run.
+        //! A render target pass whose context is clean disables itself, its image keeps the last frame.
+        void UpdateContextDirty();
+
+        bool IsEnabled() const override;
+
+        //! Records the next draw list ahead of SetupFrameGraphDependencies, from the render interface's draw list job
+        void RecordDrawCommandsAhead();
+
         AZ::Data::Instance<AZ::RPI::AttachmentImage> GetAttachmentImage() const
         {
             return m_attachmentImage;
@@ -134,30 +175,56 @@ namespace TuRml
         void BuildCommandListInternal(const AZ::RHI::FrameGraphExecuteContext& context) override;
         void FrameEndInternal() override;
 
-        void StandardPipelineStateInit(AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw>& ps);
-        void StandardPipelineStateFinish(AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw>& ps);
+        //! Renders the context into the next draw list, or keeps the current one if nothing changed
+        void RecordDrawCommands();
+        //! Finds the render target area where the draw lists differ, the rest keeps the previous frame
+        void UpdateDamage(const FrameInfo& previousFrame, const FrameInfo& currentFrame);
+        //! Draws a fullscreen triangle with pipelineState, scissored to region unless it's empty
+        void SubmitFullscreenTriangle(const AZ::RHI::FrameGraphExecuteContext& context,
+                                      const AZ::RPI::PipelineStateForDraw& pipelineState, const Rml::Rectanglei& region,
+                                      uint32_t submitIndex);
 
     private:
         friend class TuRmlRenderInterface;
+        friend class TuRmlContextRenderInterface;
 
         TuRmlChildPass() = delete;
         explicit TuRmlChildPass(const AZ::RPI::PassDescriptor& descriptor);
 
         AZ::Data::Instance<AZ::RPI::AttachmentImage> m_attachmentImage;
+        AZ::Data::Instance<AZ::RPI::AttachmentImage> m_depthStencilImage;
         Rml::Context* m_rmlContext = nullptr;
 
         BufferedTuRmlDrawCommands m_drawCommands = {};
+        //! Transient geometry and batches for this pass, copied in from CPU memory at End()
+        TuRmlRingBuffer m_transientRing{ "TuRml Transient Ring" };
 
-        AZStd::unique_ptr<SrgRecycler> m_srgRecycler;
         AZ::Data::Instance<AZ::RPI::Shader> m_shader;
-
-        //! Shader for clearing stencil buffer (fullscreen triangle)
-        AZ::Data::Instance<AZ::RPI::Shader> m_clearShader;
-        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> m_clearStencilPipelineState;
-
-        void CreatePipelineStates(PipelineStates& states, AZ::Data::Instance<AZ::RPI::Shader> shader);
-
-        PipelineStates m_standard;
-        AZ::u8 m_submittedIdx = 0;
+        //! From the render interface's TuRmlPipelineStateCache, reacquired whenever the pass is rebuilt
+        TuRmlPassPipelineStates m_pipelineStates;
+
+        //! The context changed since it was last rendered, from UpdateContextDirty
+        bool m_contextDirty = true;
+        //! The scheduler skipped the context's update, its last draw list is kept even without retained mode
+        bool m_contextHeld = false;
+        //! RecordDrawCommandsAhead ran, SetupFrameGraphDependencies picks its draw list up instead of recording
+        bool m_drawCommandsRecorded = false;
+        //! The context was unchanged, this frame submits the previous draw list again
+        bool m_reusedFrame = false;
+        size_t m_reusedFrameCount = 0;
+
+        //! The render target holds a complete frame of the context
+        bool m_renderTargetValid = false;
+        //! Nothing to draw into the render target this frame, the pass is disabled
+        bool m_renderTargetClean = false;
+        size_t m_skippedFrameCount = 0;
+
+        //! The render target is loaded, m_damageRect is cleared to transparent and only draws touching it are
+        //! submitted, scissored to it
+        bool m_partialRedraw = false;
+        Rml::Rectanglei m_damageRect;
+        size_t m_partialRedrawCount = 0;
+        //! Part of the render target the last partial redraw covered
+        float m_damageCoverage = 0.0f;
     };
 }
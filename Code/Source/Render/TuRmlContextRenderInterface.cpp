@@ -0,0 +1,874 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#include "TuRmlContextRenderInterface.h"
+#include "RmlBudget.h"
+#include "TuRmlChildPass.h"
+
+#include <AzCore/Console/IConsole.h>
+#include <AzCore/Math/Vector4.h>
+#include <AzCore/std/limits.h>
+#include <AzCore/std/math.h>
+
+#include <RmlUi/Core/Context.h>
+
+namespace TuRml
+{
+    AZ_CVAR_EXTERNED(bool, r_rmlBatching);
+    AZ_CVAR(bool, r_rmlCulling, true, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Drop draws whose geometry lies entirely outside the scissor region or the context");
+    AZ_CVAR(bool, r_rmlReorderDraws, true, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Move draws past ones they don't overlap to group them by texture and pipeline state");
+    AZ_CVAR(int, r_rmlReorderWindow, 64, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "How many earlier draws reordering looks back through for one with the same state");
+    AZ_CVAR(bool, r_rmlInstancing, true, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Draw consecutive uses of the same geometry with identical state as one instanced draw");
+    AZ_CVAR(bool, r_rmlClipMaskScissor, true, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Apply untransformed rectangular clip masks as a scissor rectangle instead of through the stencil buffer");
+    AZ_CVAR(bool, r_rmlStencilClearBounds, true, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Limit stencil clears to the area clip masks were written in since the previous clear");
+    AZ_CVAR(bool, r_rmlStencilRefRecycling, true, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Write each clip mask with an unused stencil reference value instead of clearing the stencil first");
+
+    // Set masks stop recycling references here, what's left is for intersections with the mask
+    static constexpr uint8_t MaxRecycledStencilRef = 0xFF - 16;
+
+    static Rml::Rectanglei IntersectRects(const Rml::Rectanglei& lhs, const Rml::Rectanglei& rhs)
+    {
+        return Rml::Rectanglei::FromCorners(
+            Rml::Vector2i(AZStd::max(lhs.p0.x, rhs.p0.x), AZStd::max(lhs.p0.y, rhs.p0.y)),
+            Rml::Vector2i(AZStd::min(lhs.p1.x, rhs.p1.x), AZStd::min(lhs.p1.y, rhs.p1.y)));
+    }
+
+    TuRmlContextRenderInterface::TuRmlContextRenderInterface(TuRmlRenderInterface& resources)
+        : m_resources(resources)
+    {
+    }
+
+    void TuRmlContextRenderInterface::Begin(Rml::Context* ctx, TuRmlChildPass* pass)
+    {
+        AZ_Assert(m_pass == nullptr, "Begin already called!");
+        // Clear any previous draw commands to start fresh
+        m_pass = pass;
+        m_pass->m_transientRing.BeginFrame(TuRmlRenderInterface::GetFramesInFlight());
+        GetDrawCommands().clear();
+        m_pass->m_drawCommands.Get().queuedFreeGeos.clear();
+        m_pass->m_drawCommands.Get().batches.clear();
+        m_pass->m_drawCommands.Get().batchSources.clear();
+        m_pass->m_drawCommands.Get().instanceTranslations.clear();
+        m_pass->m_drawCommands.Get().instancedDrawCount = 0;
+        m_pass->m_drawCommands.Get().culledDrawCount = 0;
+        m_pass->m_drawCommands.Get().scissorClipMaskCount = 0;
+        m_pass->m_drawCommands.Get().stencilClearCount = 0;
+        m_pass->m_drawCommands.Get().stencilClearsSkipped = 0;
+        m_pass->m_drawCommands.Get().stencilClearArea = 0;
+
+        m_transform = AZ::Matrix4x4::CreateIdentity();
+
+        const Rml::Vector2i dia = ctx->GetDimensions();
+        m_contextDimensions = Rml::Vector2f(static_cast<float>(dia.x), static_cast<float>(dia.y));
+
+        auto ortho = Rml::Matrix4f::ProjectOrtho(
+            0.0f,
+            static_cast<float>(dia.x),
+            static_cast<float>(dia.y),
+            0.0f,
+            -1000, 1000);
+
+        m_contextTransform = AZ::Matrix4x4::CreateFromColumnMajorFloat16(reinterpret_cast<const float*>(&ortho));
+
+        m_stencilRef = 1;
+        m_clipStencilActive = true;
+        m_clipRectActive = false;
+        // The pass clears the stencil when it starts
+        m_stencilDirty = false;
+        m_stencilHighWater = 0;
+        SetTransform(nullptr);
+    }
+
+    void TuRmlContextRenderInterface::End()
+    {
+        AZ_PROFILE_FUNCTION(RmlBudget);
+
+        // Detect transient geometry: geometry created AND queued for release in the same frame
+        const auto& queuedFreeGeos = m_pass->m_drawCommands.Get().queuedFreeGeos;
+
+        for (auto handle : queuedFreeGeos)
+        {
+            // If this geometry was created this frame AND is being released, it's transient
+            auto* geo = m_resources.GetStoredGeometry(handle);
+            if (geo && geo->createdThisFrame && geo->storageType == TuRmlStoredGeometry::StorageType::Undecided)
+            {
+                geo->storageType = TuRmlStoredGeometry::StorageType::Transient;
+            }
+        }
+
+        for (auto handle : m_createdThisFrame)
+        {
+            if (auto* geo = m_resources.GetStoredGeometry(handle))
+            {
+                geo->createdThisFrame = false;
+            }
+        }
+        m_createdLastFrameCount = m_createdThisFrame.size();
+        m_createdThisFrame.clear();
+
+        auto& drawCmds = GetDrawCommands();
+
+        // Mark any remaining Undecided geometry as Persistent. It stays resident from here, whether it's batched or
+        // uploaded, so later compiles of the same content can share it.
+        for (const auto& cmd : drawCmds)
+        {
+            auto* geo = m_resources.GetStoredGeometry(cmd.drawCommand.geometryHandle);
+            if (geo && geo->storageType == TuRmlStoredGeometry::StorageType::Undecided)
+            {
+                geo->storageType = TuRmlStoredGeometry::StorageType::Persistent;
+                m_resources.AddToDedupCache(*geo);
+            }
+        }
+
+        // Persistent geometry released this frame loses its heap space at frame end
+        auto& frameInfo = m_pass->m_drawCommands.Get();
+        frameInfo.retainable = true;
+        frameInfo.geometryGeneration = m_resources.GetGeometryGeneration();
+        for (auto handle : queuedFreeGeos)
+        {
+            const auto* geo = m_resources.GetStoredGeometry(handle);
+            if (geo && geo->storageType == TuRmlStoredGeometry::StorageType::Persistent)
+            {
+                frameInfo.retainable = false;
+                break;
+            }
+        }
+
+        frameInfo.originalDrawCount = drawCmds.size();
+        frameInfo.reorderStateChangesSaved = 0;
+        if (r_rmlReorderDraws)
+        {
+            ReorderDrawCommands();
+        }
+        if (r_rmlInstancing)
+        {
+            InstanceDrawCommands();
+        }
+        // Before batching, which bakes the resolved UV rects into the batch vertices
+        m_resources.ResolveTextures(frameInfo);
+        if (r_rmlBatching)
+        {
+            BatchDrawCommands();
+        }
+
+        AllocateGPUBuffers();
+
+        m_pass = nullptr;
+    }
+
+#pragma region Rml::RenderInterface
+    Rml::CompiledGeometryHandle TuRmlContextRenderInterface::CompileGeometry(Rml::Span<const Rml::Vertex> vertices,
+                                                                             Rml::Span<const int> indices)
+    {
+        const Rml::CompiledGeometryHandle handle = m_resources.CompileGeometry(vertices, indices, m_pass);
+
+        // Only set on new geometry, shared duplicates were compiled in an earlier frame
+        const auto* geo = m_pass ? m_resources.GetStoredGeometry(handle) : nullptr;
+        if (geo && geo->createdThisFrame)
+        {
+            m_createdThisFrame.push_back(handle);
+        }
+        return handle;
+    }
+
+    void TuRmlContextRenderInterface::RenderGeometry(Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation,
+                                                     Rml::TextureHandle texture)
+    {
+        if (!geometry)
+        {
+            return;
+        }
+
+        const auto* storedGeo = m_resources.GetStoredGeometry(geometry);
+        if (!storedGeo)
+        {
+            AZ_Error("TuRmlRenderInterface", false, "Rendering geometry with stale handle 0x%llx",
+                     static_cast<unsigned long long>(geometry));
+            return;
+        }
+
+        TuRmlDrawCommand drawCmd;
+        drawCmd.geometryHandle = geometry;
+        drawCmd.translation = AZ::Vector2(translation.x, translation.y);
+        drawCmd.texture = texture;
+        drawCmd.transform = m_transform;
+        drawCmd.clipmaskEnabled = m_testClipMask;
+        drawCmd.stencilRef = m_stencilRef;
+        drawCmd.scissorRegion = m_scissorEnabled ? m_scissorRegion : Rml::Rectanglei();
+
+        // A rectangular clip mask is part of the scissor region, draws only test the stencil if it holds one too
+        if (m_testClipMask && !m_draw_to_clipmask)
+        {
+            drawCmd.clipmaskEnabled = m_clipStencilActive;
+            if (m_clipRectActive)
+            {
+                Rml::Rectanglei& scissor = drawCmd.scissorRegion;
+                scissor = m_scissorEnabled ? IntersectRects(scissor, m_clipRect) : m_clipRect;
+                // An empty region would read as no scissor at all
+                if (scissor.p1.x <= scissor.p0.x || scissor.p1.y <= scissor.p0.y)
+                {
+                    ++m_pass->m_drawCommands.Get().culledDrawCount;
+                    return;
+                }
+            }
+        }
+
+        const bool scissored = drawCmd.scissorRegion != Rml::Rectanglei();
+        drawCmd.bounds = GetScreenBounds(*storedGeo, translation, scissored ? &drawCmd.scissorRegion : nullptr);
+        drawCmd.geometrySerial = storedGeo->serial;
+
+        // Off screen or scissored away entirely, clip mask writes there wouldn't change anything either
+        const Rml::Rectanglef& bounds = drawCmd.bounds;
+        if (r_rmlCulling &&
+            (bounds.p1.x <= bounds.p0.x || bounds.p1.y <= bounds.p0.y || bounds.p1.x <= 0.0f || bounds.p1.y <= 0.0f ||
+             bounds.p0.x >= m_contextDimensions.x || bounds.p0.y >= m_contextDimensions.y))
+        {
+            ++m_pass->m_drawCommands.Get().culledDrawCount;
+            return;
+        }
+
+        if (m_draw_to_clipmask)
+        {
+            drawCmd.drawType = TuRmlDrawCommand::DrawType::Clipmask;
+            drawCmd.clipmask_op = m_clipmaskOperation;
+        }
+        else
+        {
+            drawCmd.drawType = TuRmlDrawCommand::DrawType::Normal;
+            drawCmd.clipmask_op = m_clipmaskOperation;
+        }
+
+        GetDrawCommands().push_back({drawCmd});
+    }
+
+    void TuRmlContextRenderInterface::ReleaseGeometry(Rml::CompiledGeometryHandle geometry)
+    {
+        m_resources.ReleaseGeometry(geometry, m_pass);
+    }
+
+    Rml::TextureHandle TuRmlContextRenderInterface::LoadTexture(Rml::Vector2i& texture_dimensions,
+                                                                const Rml::String& source)
+    {
+        return m_resources.LoadTexture(texture_dimensions, source);
+    }
+
+    Rml::TextureHandle TuRmlContextRenderInterface::GenerateTexture(Rml::Span<const Rml::byte> source,
+                                                                    Rml::Vector2i source_dimensions)
+    {
+        return m_resources.GenerateTexture(source, source_dimensions);
+    }
+
+    void TuRmlContextRenderInterface::ReleaseTexture(Rml::TextureHandle texture)
+    {
+        m_resources.ReleaseTexture(texture);
+    }
+
+    void TuRmlContextRenderInterface::EnableScissorRegion(bool enable)
+    {
+        m_scissorEnabled = enable;
+    }
+
+    void TuRmlContextRenderInterface::SetScissorRegion(Rml::Rectanglei region)
+    {
+        m_scissorRegion = region;
+    }
+
+    void TuRmlContextRenderInterface::SetTransform(const Rml::Matrix4f* transform)
+    {
+        m_hasTransform = transform != nullptr;
+        if (transform)
+        {
+            m_transform = m_contextTransform * AZ::Matrix4x4::CreateFromColumnMajorFloat16(
+                reinterpret_cast<const float*>(transform));
+        }
+        else
+        {
+            m_transform = m_contextTransform * AZ::Matrix4x4::CreateIdentity();
+        }
+    }
+
+    void TuRmlContextRenderInterface::EnableClipMask(bool enable)
+    {
+        m_testClipMask = enable;
+    }
+
+    void TuRmlContextRenderInterface::RenderToClipMask(Rml::ClipMaskOperation operation,
+                                                       Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation)
+    {
+        // Rectangles skip the stencil clear, the mask draw and stencil testing, later draws just get scissored
+        Rml::Rectanglei rect;
+        const auto* storedGeo = m_resources.GetStoredGeometry(geometry);
+        if (storedGeo && operation != Rml::ClipMaskOperation::SetInverse &&
+            GetClipMaskRect(*storedGeo, translation, rect))
+        {
+            if (operation == Rml::ClipMaskOperation::Set)
+            {
+                m_clipStencilActive = false;
+                m_clipRect = rect;
+            }
+            else
+            {
+                m_clipRect = m_clipRectActive ? IntersectRects(m_clipRect, rect) : rect;
+            }
+            m_clipRectActive = true;
+            ++m_pass->m_drawCommands.Get().scissorClipMaskCount;
+            return;
+        }
+
+        if (operation != Rml::ClipMaskOperation::Intersect)
+        {
+            m_clipRectActive = false;
+        }
+        else if (!m_clipStencilActive)
+        {
+            // The stencil doesn't hold the mask so far, that's the rectangle which stays as the scissor
+            operation = Rml::ClipMaskOperation::Set;
+        }
+        m_clipStencilActive = true;
+
+        // Nothing was written since the stencil was last zero
+        if (!m_stencilDirty)
+        {
+            m_stencilHighWater = 0;
+        }
+
+        // Set writes the next reference value nothing in the stencil holds yet, earlier masks then fail the equal
+        // test without a clear. SetInverse needs zero outside its mask, so it still clears.
+        if (operation != Rml::ClipMaskOperation::Intersect)
+        {
+            const bool recycle = operation == Rml::ClipMaskOperation::Set && r_rmlStencilRefRecycling &&
+                m_stencilHighWater < MaxRecycledStencilRef;
+            if (!recycle && m_stencilDirty)
+            {
+                ClearStencil();
+            }
+            else
+            {
+                ++m_pass->m_drawCommands.Get().stencilClearsSkipped;
+            }
+        }
+
+        // Reference the mask is written with, and the one draws test against afterwards
+        uint8_t maskStencilRef = m_stencilRef;
+        uint8_t testStencilRef = m_stencilRef;
+        switch (operation)
+        {
+        case Rml::ClipMaskOperation::Set:
+            maskStencilRef = ++m_stencilHighWater;
+            testStencilRef = maskStencilRef;
+            break;
+        case Rml::ClipMaskOperation::SetInverse:
+            maskStencilRef = ++m_stencilHighWater;
+            testStencilRef = 0;
+            break;
+        case Rml::ClipMaskOperation::Intersect:
+            // Incrementing raises every value under the mask, including the highest one
+            m_stencilHighWater = static_cast<uint8_t>(AZStd::min(m_stencilHighWater + 1, 0xFF));
+            testStencilRef = static_cast<uint8_t>(AZStd::min(m_stencilRef + 1, 0xFF));
+            break;
+        }
+
+        m_draw_to_clipmask = true;
+        m_clipmaskOperation = operation;
+        m_stencilRef = maskStencilRef;
+
+        auto& drawCmds = GetDrawCommands();
+        const size_t drawCount = drawCmds.size();
+        RenderGeometry(geometry, translation, {});
+        if (drawCmds.size() > drawCount)
+        {
+            const Rml::Rectanglef& bounds = drawCmds.back().drawCommand.bounds;
+            m_stencilDirtyBounds = m_stencilDirty ? m_stencilDirtyBounds.Join(bounds) : bounds;
+            m_stencilDirty = true;
+        }
+
+        m_stencilRef = testStencilRef;
+        m_draw_to_clipmask = false;
+    }
+
+    void TuRmlContextRenderInterface::ClearStencil()
+    {
+        auto& frameInfo = m_pass->m_drawCommands.Get();
+        m_stencilDirty = false;
+        m_stencilHighWater = 0;
+
+        TuRmlDrawCommand drawCmd;
+        drawCmd.drawType = TuRmlDrawCommand::DrawType::ClearClipmask;
+        drawCmd.bounds = Rml::Rectanglef::FromSize(m_contextDimensions);
+        if (r_rmlStencilClearBounds)
+        {
+            // Whole pixels around the masks, clamped to the context
+            const Rml::Rectanglef& dirty = m_stencilDirtyBounds;
+            drawCmd.scissorRegion = Rml::Rectanglei::FromCorners(
+                Rml::Vector2i(static_cast<int>(AZStd::max(AZStd::floor(dirty.p0.x), 0.0f)),
+                              static_cast<int>(AZStd::max(AZStd::floor(dirty.p0.y), 0.0f))),
+                Rml::Vector2i(static_cast<int>(AZStd::min(AZStd::ceil(dirty.p1.x), m_contextDimensions.x)),
+                              static_cast<int>(AZStd::min(AZStd::ceil(dirty.p1.y), m_contextDimensions.y))));
+            const Rml::Rectanglei& region = drawCmd.scissorRegion;
+            // Masks entirely outside the context left nothing to clear, an empty region would read as no scissor
+            if (region.p1.x <= region.p0.x || region.p1.y <= region.p0.y)
+            {
+                ++frameInfo.stencilClearsSkipped;
+                return;
+            }
+            drawCmd.bounds = Rml::Rectanglef(region);
+        }
+
+        ++frameInfo.stencilClearCount;
+        frameInfo.stencilClearArea += static_cast<size_t>(drawCmd.bounds.Width() * drawCmd.bounds.Height());
+        GetDrawCommands().push_back({drawCmd});
+    }
+
+    AZStd::vector<TuRmlChildPassDrawCommand>& TuRmlContextRenderInterface::GetDrawCommands() const
+    {
+        return m_pass->m_drawCommands.Get().drawCmds;
+    }
+
+#pragma endregion
+
+    bool TuRmlContextRenderInterface::GetClipMaskRect(const TuRmlStoredGeometry& geo, Rml::Vector2f translation,
+                                                      Rml::Rectanglei& rect) const
+    {
+        if (!r_rmlClipMaskScissor || !geo.axisAlignedRect || m_hasTransform)
+        {
+            return false;
+        }
+
+        // The pixels whose centers the rectangle covers, same as rasterizing it
+        const Rml::Vector2f p0 = geo.boundsMin + translation;
+        const Rml::Vector2f p1 = geo.boundsMax + translation;
+        rect = Rml::Rectanglei::FromCorners(
+            Rml::Vector2i(static_cast<int>(AZStd::ceil(p0.x - 0.5f)), static_cast<int>(AZStd::ceil(p0.y - 0.5f))),
+            Rml::Vector2i(static_cast<int>(AZStd::ceil(p1.x - 0.5f)), static_cast<int>(AZStd::ceil(p1.y - 0.5f))));
+        return true;
+    }
+
+    Rml::Rectanglef TuRmlContextRenderInterface::GetScreenBounds(const TuRmlStoredGeometry& geo,
+                                                                 Rml::Vector2f translation,
+                                                                 const Rml::Rectanglei* scissorRegion) const
+    {
+        Rml::Vector2f p0 = geo.boundsMin + translation;
+        Rml::Vector2f p1 = geo.boundsMax + translation;
+
+        if (m_hasTransform)
+        {
+            const Rml::Vector2f corners[] = { p0, { p1.x, p0.y }, { p0.x, p1.y }, p1 };
+            constexpr float maxFloat = AZStd::numeric_limits<float>::max();
+            p0 = Rml::Vector2f(maxFloat, maxFloat);
+            p1 = Rml::Vector2f(-maxFloat, -maxFloat);
+            for (const Rml::Vector2f& corner : corners)
+            {
+                const AZ::Vector4 clip = m_transform * AZ::Vector4(corner.x, corner.y, 0.0f, 1.0f);
+                if (clip.GetW() <= AZ::Constants::FloatEpsilon)
+                {
+                    // Crosses the camera plane, could be anywhere
+                    return Rml::Rectanglef::FromCorners({}, m_contextDimensions);
+                }
+
+                // Clip space back to pixels, y points down
+                const Rml::Vector2f pixel(
+                    (clip.GetX() / clip.GetW() * 0.5f + 0.5f) * m_contextDimensions.x,
+                    (0.5f - clip.GetY() / clip.GetW() * 0.5f) * m_contextDimensions.y);
+                p0 = Rml::Vector2f(AZStd::min(p0.x, pixel.x), AZStd::min(p0.y, pixel.y));
+                p1 = Rml::Vector2f(AZStd::max(p1.x, pixel.x), AZStd::max(p1.y, pixel.y));
+            }
+        }
+
+        if (scissorRegion)
+        {
+            p0.x = AZStd::max(p0.x, static_cast<float>(scissorRegion->p0.x));
+            p0.y = AZStd::max(p0.y, static_cast<float>(scissorRegion->p0.y));
+            p1.x = AZStd::max(p0.x, AZStd::min(p1.x, static_cast<float>(scissorRegion->p1.x)));
+            p1.y = AZStd::max(p0.y, AZStd::min(p1.y, static_cast<float>(scissorRegion->p1.y)));
+        }
+        return Rml::Rectanglef::FromCorners(p0, p1);
+    }
+
+    bool TuRmlContextRenderInterface::CanMergeDrawCommands(const TuRmlDrawCommand& lhs, const TuRmlDrawCommand& rhs)
+    {
+        // Vertices are 2D and the transform may be projective, so only the translation gets baked.
+        return lhs.drawType == rhs.drawType &&
+            (lhs.texture == rhs.texture ||
+             m_resources.GetTextureBindingKey(lhs.texture) == m_resources.GetTextureBindingKey(rhs.texture)) &&
+            lhs.clipmaskEnabled == rhs.clipmaskEnabled &&
+            lhs.stencilRef == rhs.stencilRef &&
+            (lhs.drawType != TuRmlDrawCommand::DrawType::Clipmask || lhs.clipmask_op == rhs.clipmask_op) &&
+            lhs.scissorRegion == rhs.scissorRegion &&
+            lhs.transform == rhs.transform &&
+            m_resources.IsBatchable(rhs);
+    }
+
+    void TuRmlContextRenderInterface::ReorderDrawCommands()
+    {
+        AZ_PROFILE_FUNCTION(RmlBudget);
+        auto& frameInfo = m_pass->m_drawCommands.Get();
+        auto& drawCmds = frameInfo.drawCmds;
+        const size_t window = static_cast<size_t>(AZStd::max(static_cast<int>(r_rmlReorderWindow), 0));
+
+        // Clip mask writes and stencil clears change what later draws see, nothing moves past them
+        const auto isBarrier = [](const TuRmlDrawCommand& cmd)
+        {
+            return cmd.drawType != TuRmlDrawCommand::DrawType::Normal;
+        };
+        const auto isSameState = [](const TuRmlDrawCommand& lhs, uintptr_t lhsKey,
+                                    const TuRmlDrawCommand& rhs, uintptr_t rhsKey)
+        {
+            return lhs.drawType == rhs.drawType &&
+                lhsKey == rhsKey &&
+                lhs.clipmaskEnabled == rhs.clipmaskEnabled &&
+                lhs.stencilRef == rhs.stencilRef &&
+                lhs.scissorRegion == rhs.scissorRegion &&
+                lhs.transform == rhs.transform;
+        };
+
+        AZStd::vector<TuRmlChildPassDrawCommand> reorderedCmds;
+        reorderedCmds.reserve(drawCmds.size());
+        // Texture binding of each reordered command, atlas pages count as one
+        AZStd::vector<uintptr_t> reorderedKeys;
+        reorderedKeys.reserve(drawCmds.size());
+
+        size_t stateChangesBefore = 0;
+        uintptr_t previousKey = 0;
+        for (size_t i = 0; i < drawCmds.size(); ++i)
+        {
+            const TuRmlDrawCommand& cmd = drawCmds[i].drawCommand;
+            const uintptr_t key = isBarrier(cmd) ? 0 : m_resources.GetTextureBindingKey(cmd.texture);
+            if (i > 0 && !isSameState(drawCmds[i - 1].drawCommand, previousKey, cmd, key))
+            {
+                ++stateChangesBefore;
+            }
+            previousKey = key;
+
+            // Look back for a draw with the same state, everything after it must not overlap this one
+            size_t insertAt = reorderedCmds.size();
+            if (!isBarrier(cmd))
+            {
+                const size_t scanEnd = reorderedCmds.size() > window ? reorderedCmds.size() - window : 0;
+                for (size_t j = reorderedCmds.size(); j > scanEnd; --j)
+                {
+                    const TuRmlDrawCommand& other = reorderedCmds[j - 1].drawCommand;
+                    if (isBarrier(other))
+                    {
+                        break;
+                    }
+                    if (isSameState(other, reorderedKeys[j - 1], cmd, key))
+                    {
+                        insertAt = j;
+                        break;
+                    }
+                    if (other.bounds.Intersects(cmd.bounds))
+                    {
+                        break;
+                    }
+                }
+            }
+
+            reorderedCmds.insert(reorderedCmds.begin() + insertAt, drawCmds[i]);
+            reorderedKeys.insert(reorderedKeys.begin() + insertAt, key);
+        }
+
+        size_t stateChangesAfter = 0;
+        for (size_t i = 1; i < reorderedCmds.size(); ++i)
+        {
+            if (!isSameState(reorderedCmds[i - 1].drawCommand, reorderedKeys[i - 1],
+                             reorderedCmds[i].drawCommand, reorderedKeys[i]))
+            {
+                ++stateChangesAfter;
+            }
+        }
+
+        frameInfo.reorderStateChangesSaved = stateChangesBefore - stateChangesAfter;
+        drawCmds = AZStd::move(reorderedCmds);
+    }
+
+    void TuRmlContextRenderInterface::InstanceDrawCommands()
+    {
+        AZ_PROFILE_FUNCTION(RmlBudget);
+        auto& frameInfo = m_pass->m_drawCommands.Get();
+        auto& drawCmds = frameInfo.drawCmds;
+
+        // Batching already merges small geometry together with its neighbours, leave that to it
+        const auto canInstance = [this](const TuRmlDrawCommand& cmd)
+        {
+            return cmd.drawType != TuRmlDrawCommand::DrawType::ClearClipmask && cmd.geometryHandle &&
+                (!r_rmlBatching || !m_resources.IsBatchable(cmd));
+        };
+
+        AZStd::vector<TuRmlChildPassDrawCommand> instancedCmds;
+        instancedCmds.reserve(drawCmds.size());
+
+        // Only consecutive commands, so painter's order is kept
+        size_t runStart = 0;
+        while (runStart < drawCmds.size())
+        {
+            const TuRmlDrawCommand& first = drawCmds[runStart].drawCommand;
+            size_t runEnd = runStart + 1;
+            if (canInstance(first))
+            {
+                while (runEnd < drawCmds.size())
+                {
+                    const TuRmlDrawCommand& next = drawCmds[runEnd].drawCommand;
+                    if (next.geometryHandle != first.geometryHandle || next.drawType != first.drawType ||
+                        next.texture != first.texture || next.clipmaskEnabled != first.clipmaskEnabled ||
+                        next.stencilRef != first.stencilRef || next.clipmask_op != first.clipmask_op ||
+                        next.scissorRegion != first.scissorRegion || next.transform != first.transform)
+                    {
+                        break;
+                    }
+                    ++runEnd;
+                }
+            }
+
+            if (runEnd - runStart == 1)
+            {
+                instancedCmds.push_back(drawCmds[runStart]);
+                runStart = runEnd;
+                continue;
+            }
+
+            TuRmlChildPassDrawCommand instancedCmd = drawCmds[runStart];
+            instancedCmd.instanceCount = static_cast<uint32_t>(runEnd - runStart);
+            instancedCmd.firstInstance = static_cast<uint32_t>(frameInfo.instanceTranslations.size());
+            for (size_t i = runStart; i < runEnd; ++i)
+            {
+                frameInfo.instanceTranslations.push_back(drawCmds[i].drawCommand.translation);
+                instancedCmd.drawCommand.bounds = instancedCmd.drawCommand.bounds.Join(drawCmds[i].drawCommand.bounds);
+            }
+            instancedCmds.push_back(instancedCmd);
+            ++frameInfo.instancedDrawCount;
+
+            runStart = runEnd;
+        }
+
+        drawCmds = AZStd::move(instancedCmds);
+    }
+
+    void TuRmlContextRenderInterface::BatchDrawCommands()
+    {
+        AZ_PROFILE_FUNCTION(RmlBudget);
+        auto& frameInfo = m_pass->m_drawCommands.Get();
+        auto& drawCmds = frameInfo.drawCmds;
+
+        AZStd::vector<TuRmlChildPassDrawCommand> batchedCmds;
+        batchedCmds.reserve(drawCmds.size());
+
+        // Only consecutive commands are merged so painter's order is kept.
+        size_t runStart = 0;
+        while (runStart < drawCmds.size())
+        {
+            const TuRmlDrawCommand& first = drawCmds[runStart].drawCommand;
+            size_t runEnd = runStart + 1;
+            if (drawCmds[runStart].instanceCount == 1 && m_resources.IsBatchable(first))
+            {
+                while (runEnd < drawCmds.size() && drawCmds[runEnd].instanceCount == 1 &&
+                       CanMergeDrawCommands(first, drawCmds[runEnd].drawCommand))
+                {
+                    ++runEnd;
+                }
+            }
+
+            if (runEnd - runStart == 1)
+            {
+                batchedCmds.push_back(drawCmds[runStart]);
+                runStart = runEnd;
+                continue;
+            }
+
+            TuRmlDrawBatch batch;
+            batch.firstSource = frameInfo.batchSources.size();
+            batch.sourceCount = runEnd - runStart;
+            for (size_t i = runStart; i < runEnd; ++i)
+            {
+                const auto* geo = m_resources.GetStoredGeometry(drawCmds[i].drawCommand.geometryHandle);
+                batch.vertexCount += geo->vertexCount;
+                batch.indexCount += geo->indexCount;
+                frameInfo.batchSources.push_back(drawCmds[i].drawCommand);
+            }
+
+            TuRmlChildPassDrawCommand mergedCmd;
+            mergedCmd.drawCommand = first;
+            mergedCmd.drawCommand.geometryHandle = 0;
+            mergedCmd.drawCommand.geometrySerial = 0;
+            mergedCmd.drawCommand.translation = AZ::Vector2::CreateZero();
+            mergedCmd.textureSrg = drawCmds[runStart].textureSrg;
+            for (size_t i = runStart + 1; i < runEnd; ++i)
+            {
+                mergedCmd.drawCommand.bounds = mergedCmd.drawCommand.bounds.Join(drawCmds[i].drawCommand.bounds);
+            }
+            mergedCmd.batchIndex = static_cast<int32_t>(frameInfo.batches.size());
+            frameInfo.batches.push_back(batch);
+            batchedCmds.push_back(mergedCmd);
+
+            runStart = runEnd;
+        }
+
+        drawCmds = AZStd::move(batchedCmds);
+    }
+
+    void TuRmlContextRenderInterface::AllocateGPUBuffers()
+    {
+        AZ_PROFILE_FUNCTION(RmlBudget);
+        auto& frameInfo = m_pass->m_drawCommands.Get();
+        auto& drawCmds = frameInfo.drawCmds;
+        auto& ring = m_pass->m_transientRing;
+
+        // Batches are baked first, the baked vertices decide the format they go into the ring with
+        for (auto& batch : frameInfo.batches)
+        {
+            m_batchVertices.resize(batch.vertexCount);
+            m_batchIndices.resize(batch.indexCount);
+            Rml::Vertex* bakedVertices = m_batchVertices.data();
+            int* bakedIndices = m_batchIndices.data();
+
+            int baseVertex = 0;
+            for (size_t i = 0; i < batch.sourceCount; ++i)
+            {
+                const TuRmlDrawCommand& source = frameInfo.batchSources[batch.firstSource + i];
+                const auto* geo = m_resources.GetStoredGeometry(source.geometryHandle);
+                const Rml::Vector2f translation(source.translation.GetX(), source.translation.GetY());
+
+                // Sources may use different textures on the same atlas page, so their UVs get baked as well
+                const Rml::Vector2f uvOffset(source.uvRect.GetX(), source.uvRect.GetY());
+                const Rml::Vector2f uvScale(source.uvRect.GetZ(), source.uvRect.GetW());
+
+                for (const Rml::Vertex& vertex : geo->vertices)
+                {
+                    Rml::Vertex baked = vertex;
+                    baked.position += translation;
+                    baked.tex_coord = uvOffset + baked.tex_coord * uvScale;
+                    *bakedVertices++ = baked;
+                }
+
+                for (const int index : geo->indices)
+                {
+                    *bakedIndices++ = index + baseVertex;
+                }
+
+                baseVertex += static_cast<int>(geo->vertexCount);
+            }
+
+            batch.format = TuRmlVertexFormat::Choose(m_batchVertices.data(), batch.vertexCount);
+            batch.vertexAllocation = ring.Allocate(batch.vertexCount * batch.format.GetVertexStride(), sizeof(float));
+            batch.indexAllocation = ring.Allocate(batch.indexCount * batch.format.GetIndexSize(), sizeof(int));
+            if (!batch.vertexAllocation.IsValid() || !batch.indexAllocation.IsValid())
+            {
+                batch.vertexAllocation = {};
+                batch.indexAllocation = {};
+                continue;
+            }
+
+            batch.format.WriteVertices(m_batchVertices.data(), batch.vertexCount, batch.vertexAllocation.data);
+            batch.format.WriteIndices(m_batchIndices.data(), batch.indexCount, batch.indexAllocation.data);
+            m_resources.CountUpload(batch.format, batch.vertexCount, batch.indexCount);
+        }
+
+        for (const auto& cmd : drawCmds)
+        {
+            if (cmd.batchIndex >= 0)
+            {
+                continue;
+            }
+
+            auto* geo = m_resources.GetStoredGeometry(cmd.drawCommand.geometryHandle);
+            if (!geo || geo->uploaded || !geo->HasData())
+            {
+                continue;
+            }
+
+            if (geo->storageType == TuRmlStoredGeometry::StorageType::Persistent)
+            {
+                m_resources.UploadPersistentGeometry(*geo);
+            }
+            else if (geo->storageType == TuRmlStoredGeometry::StorageType::Transient)
+            {
+                const TuRmlVertexFormat& format = geo->format;
+                const size_t vertexBytes = geo->vertexCount * format.GetVertexStride();
+                const size_t indexBytes = geo->indexCount * format.GetIndexSize();
+
+                // Copied from the CPU copy, the ring is write-combined memory and never read back
+                if (!geo->ringVertices.IsValid())
+                {
+                    geo->ringVertices = ring.Allocate(vertexBytes, sizeof(float));
+                    geo->ringIndices = ring.Allocate(indexBytes, sizeof(int));
+                    if (!geo->ringVertices.IsValid() || !geo->ringIndices.IsValid())
+                    {
+                        geo->ringVertices = {};
+                        geo->ringIndices = {};
+                        continue;
+                    }
+                    format.WriteVertices(geo->vertices.data(), geo->vertexCount, geo->ringVertices.data);
+                    format.WriteIndices(geo->indices.data(), geo->indexCount, geo->ringIndices.data);
+                    m_resources.CountUpload(format, geo->vertexCount, geo->indexCount);
+                }
+
+                geo->vertexBufferView = AZ::RHI::StreamBufferView(
+                    *geo->ringVertices.buffer->GetRHIBuffer(),
+                    geo->ringVertices.offset,
+                    static_cast<uint32_t>(vertexBytes),
+                    static_cast<uint32_t>(format.GetVertexStride())
+                );
+
+                geo->indexBufferView = AZ::RHI::IndexBufferView(
+                    *geo->ringIndices.buffer->GetRHIBuffer(),
+                    geo->ringIndices.offset,
+                    static_cast<uint32_t>(indexBytes),
+                    format.GetIndexFormat()
+                );
+
+                geo->uploaded = true;
+                m_resources.m_vertexPool.Release(geo->vertices);
+                m_resources.m_indexPool.Release(geo->indices);
+            }
+        }
+
+        // Resolve the views each draw command will be submitted with
+        for (auto& cmd : drawCmds)
+        {
+            if (cmd.batchIndex >= 0)
+            {
+                const TuRmlDrawBatch& batch = frameInfo.batches[cmd.batchIndex];
+                if (!batch.vertexAllocation.IsValid())
+                {
+                    cmd.indexCount = 0;
+                    continue;
+                }
+
+                cmd.vertexBufferView = AZ::RHI::StreamBufferView(
+                    *batch.vertexAllocation.buffer->GetRHIBuffer(),
+                    batch.vertexAllocation.offset,
+                    static_cast<uint32_t>(batch.vertexCount * batch.format.GetVertexStride()),
+                    static_cast<uint32_t>(batch.format.GetVertexStride())
+                );
+                cmd.indexBufferView = AZ::RHI::IndexBufferView(
+                    *batch.indexAllocation.buffer->GetRHIBuffer(),
+                    batch.indexAllocation.offset,
+                    static_cast<uint32_t>(batch.indexCount * batch.format.GetIndexSize()),
+                    batch.format.GetIndexFormat()
+                );
+                cmd.indexCount = static_cast<uint32_t>(batch.indexCount);
+                cmd.compactVertices = batch.format.compactVertices;
+            }
+            else if (const auto* geo = m_resources.GetStoredGeometry(cmd.drawCommand.geometryHandle);
+                     geo && geo->uploaded)
+            {
+                cmd.vertexBufferView = geo->vertexBufferView;
+                cmd.indexBufferView = geo->indexBufferView;
+                // Clip masks leave out the anti-aliasing fringe, the stencil has no partial coverage
+                cmd.indexCount = static_cast<uint32_t>(
+                    cmd.drawCommand.drawType == TuRmlDrawCommand::DrawType::Clipmask ? geo->coreIndexCount
+                                                                                      : geo->indexCount);
+                cmd.compactVertices = geo->format.compactVertices;
+            }
+        }
+    }
+}
@@ -0,0 +1,120 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#pragma once
+
+#include <AzCore/Math/Matrix4x4.h>
+#include <AzCore/std/containers/vector.h>
+
+#include <RmlUi/Core/RenderInterface.h>
+
+#include <TuRml/Allocators.h>
+
+#include "TuRmlRenderInterface.h"
+
+namespace TuRml
+{
+    //! Records the draw lists of the contexts rendered through it.
+    //! Holds the per-frame recording state (pass, transform, scissor and clip mask), geometry and textures live in
+    //! the shared TuRmlRenderInterface. Contexts created with TuRmlRenderInterface::CreateContext get their own
+    //! instance, so their draw lists can be recorded on different threads at the same time.
+    class TuRmlContextRenderInterface final
+        : public Rml::RenderInterface
+    {
+    public:
+        AZ_CLASS_ALLOCATOR(TuRmlContextRenderInterface, TuRmlRenderAllocator);
+
+        explicit TuRmlContextRenderInterface(TuRmlRenderInterface& resources);
+
+        void Begin(Rml::Context* ctx, TuRmlChildPass* pass);
+        void End();
+
+        //! The context created with this render interface, nullptr once it's destroyed and for the shared one
+        Rml::Context* GetContext() const { return m_context; }
+        void SetContext(Rml::Context* context) { m_context = context; }
+
+        //! Geometry compiled during the last recorded frame
+        size_t GetCreatedLastFrameCount() const { return m_createdLastFrameCount; }
+
+#pragma region Rml::RenderInterface
+        Rml::CompiledGeometryHandle CompileGeometry(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices) override;
+        void RenderGeometry(Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation,
+                            Rml::TextureHandle texture) override;
+        void ReleaseGeometry(Rml::CompiledGeometryHandle geometry) override;
+
+        Rml::TextureHandle LoadTexture(Rml::Vector2i& texture_dimensions, const Rml::String& source) override;
+        Rml::TextureHandle GenerateTexture(Rml::Span<const Rml::byte> source, Rml::Vector2i source_dimensions) override;
+        void ReleaseTexture(Rml::TextureHandle texture) override;
+
+        void EnableScissorRegion(bool enable) override;
+        void SetScissorRegion(Rml::Rectanglei region) override;
+
+        void SetTransform(const Rml::Matrix4f* transform) override;
+
+        void EnableClipMask(bool enable) override;
+        void RenderToClipMask(Rml::ClipMaskOperation operation, Rml::CompiledGeometryHandle geometry,
+                              Rml::Vector2f translation) override;
+#pragma endregion
+    private:
+        [[nodiscard]] AZStd::vector<struct TuRmlChildPassDrawCommand>& GetDrawCommands() const;
+
+        // Move draws past ones they don't overlap to group them by state (called from End())
+        void ReorderDrawCommands();
+        // Fold consecutive draws of the same geometry with identical state into instanced draws (called from End())
+        void InstanceDrawCommands();
+        // Merge consecutive draw commands with identical state into batches (called from End())
+        void BatchDrawCommands();
+        [[nodiscard]] bool CanMergeDrawCommands(const TuRmlDrawCommand& lhs, const TuRmlDrawCommand& rhs);
+
+        // Projects the geometry's bounds with the current transform, clipped to the scissor region if there is one
+        [[nodiscard]] Rml::Rectanglef GetScreenBounds(const TuRmlStoredGeometry& geo, Rml::Vector2f translation,
+                                                      const Rml::Rectanglei* scissorRegion) const;
+
+        // Pixels a rectangular clip mask covers, if it can be applied as a scissor rectangle
+        [[nodiscard]] bool GetClipMaskRect(const TuRmlStoredGeometry& geo, Rml::Vector2f translation,
+                                           Rml::Rectanglei& rect) const;
+
+        // Resets the stencil buffer to zero where clip masks were written since the last clear
+        void ClearStencil();
+
+        // Allocate GPU buffers for all geometry (called after End(), before rendering)
+        void AllocateGPUBuffers();
+
+        TuRmlRenderInterface& m_resources;
+        Rml::Context* m_context = nullptr;
+
+        // Batch vertices and indices are baked here first, their format depends on the result
+        AZStd::vector<Rml::Vertex> m_batchVertices;
+        AZStd::vector<int> m_batchIndices;
+
+        //Per frame:
+        // Geometry created this frame (to detect transients), flagged with createdThisFrame as well
+        AZStd::vector<Rml::CompiledGeometryHandle> m_createdThisFrame;
+        size_t m_createdLastFrameCount = 0;
+
+        TuRmlChildPass* m_pass = nullptr;
+        AZ::Matrix4x4 m_transform;
+        AZ::Matrix4x4 m_contextTransform;
+        Rml::Vector2f m_contextDimensions;
+        // RmlUi set a transform, bounds have to be projected
+        bool m_hasTransform = false;
+        Rml::Rectanglei m_scissorRegion;
+        Rml::ClipMaskOperation m_clipmaskOperation;
+        uint8_t m_stencilRef = 0;
+        bool m_scissorEnabled = false;
+        bool m_draw_to_clipmask = false;
+        bool m_testClipMask = false;
+        // The clip mask is the stencil buffer, intersected with m_clipRect if that is active as well
+        bool m_clipStencilActive = true;
+        bool m_clipRectActive = false;
+        Rml::Rectanglei m_clipRect;
+        // Area clip masks wrote the stencil in since the last clear, the rest of it is still zero
+        bool m_stencilDirty = false;
+        Rml::Rectanglef m_stencilDirtyBounds;
+        // Highest reference value the stencil may hold, Set masks write the next one instead of clearing
+        uint8_t m_stencilHighWater = 0;
+    };
+}
@@ -5,8 +5,10 @@
  * For complete copyright and license terms please see the LICENSE at the root of this distribution.
  */
 #include "TuRmlFeatureProcessor.h"
+#include "TuRmlRenderInterface.h"
 #include "../Console/TuRmlConsoleDocument.h"
 
+#include <AzCore/Console/IConsole.h>
 #include <AzCore/Console/ILogger.h>
 #include <Atom/RPI.Public/Image/ImageSystemInterface.h>
 #include <Atom/RPI.Public/Pass/PassSystemInterface.h>
@@ -19,9 +21,13 @@
 
 #include <RmlUi/Core/Core.h>
 #include <RmlUi/Debugger/Debugger.h>
+#include <TuRml/TuRmlBus.h>
 
 namespace TuRml
 {
+    AZ_CVAR(bool, r_rmlAsyncDrawLists, true, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Record TuRml draw lists on a job started in Simulate instead of while the frame graph is set up");
+
     void TuRmlFeatureProcessor::Reflect(AZ::ReflectContext* context)
     {
         if (auto* serializeContext = azrtti_cast<AZ::SerializeContext*>(context))
@@ -37,7 +43,11 @@ namespace TuRml
         AZ::Render::Bootstrap::NotificationBus::Handler::BusConnect();
 
         auto name = GetParentScene()->GetName().GetCStr();
-        m_context = Rml::CreateContext(name, {800,600});
+        TuRmlRenderInterface* renderInterface = nullptr;
+        TuRmlRequestBus::BroadcastResult(renderInterface, &TuRmlRequestBus::Events::GetRenderInterface);
+        // Its own render interface, so the scene's draw list doesn't share recording state with other contexts
+        m_context = renderInterface ? renderInterface->CreateContext(name, {800,600})
+                                    : Rml::CreateContext(name, {800,600});
     }
 
     void TuRmlFeatureProcessor::Deactivate()
@@ -146,9 +156,14 @@ namespace TuRml
         ResizeDisplayCtxs();
         UpdateContextOutput();
 
+        TuRmlRenderInterface* renderInterface = nullptr;
+        TuRmlRequestBus::BroadcastResult(renderInterface, &TuRmlRequestBus::Events::GetRenderInterface);
+
         //TODO: Set and forget this instead of doing it on every simulate call.
+        AZStd::vector<AZ::RPI::Ptr<TuRmlChildPass>> recordPasses;
         if (m_parentPass)
         {
+            m_parentPass->UpdateMultisampleTargets();
             for (auto& [context, renderData] : m_contextRenderData)
             {
                 if (renderData.m_isActive)
@@ -156,10 +171,21 @@ namespace TuRml
                     if (auto childPass = m_parentPass->GetChildPass(context))
                     {
                         childPass->SetRmlContext(context);
+                        childPass->UpdateContextDirty();
+                        if (childPass->IsEnabled())
+                        {
+                            recordPasses.push_back(childPass);
+                        }
                     }
                 }
             }
         }
+
+        // Contexts are laid out and sized for this frame, their draw lists are ready by the time the passes run
+        if (renderInterface && r_rmlAsyncDrawLists)
+        {
+            renderInterface->RecordDrawListsAsync(AZStd::move(recordPasses));
+        }
     }
 
     void TuRmlFeatureProcessor::Render(const RenderPacket& packet)
@@ -167,6 +193,17 @@ namespace TuRml
         AZ_UNUSED(packet);
     }
 
+    void TuRmlFeatureProcessor::OnRenderEnd()
+    {
+        // Game code may change the contexts once the frame is done
+        TuRmlRenderInterface* renderInterface = nullptr;
+        TuRmlRequestBus::BroadcastResult(renderInterface, &TuRmlRequestBus::Events::GetRenderInterface);
+        if (renderInterface)
+        {
+            renderInterface->WaitForDrawLists();
+        }
+    }
+
     void TuRmlFeatureProcessor::AddRenderPasses(AZ::RPI::RenderPipeline* renderPipeline)
     {
         //Add parent pass.
@@ -249,6 +286,14 @@ namespace TuRml
     {
         if (context)
         {
+            // The draw list job may be rendering it
+            TuRmlRenderInterface* renderInterface = nullptr;
+            TuRmlRequestBus::BroadcastResult(renderInterface, &TuRmlRequestBus::Events::GetRenderInterface);
+            if (renderInterface)
+            {
+                renderInterface->WaitForDrawLists();
+            }
+
             if (m_parentPass)
             {
                 m_parentPass->RemoveChildPass(context);
@@ -52,6 +52,7 @@ namespace TuRml
         void UpdateContextOutput();
         void Simulate(const FeatureProcessor::SimulatePacket& packet) override;
         void Render(const RenderPacket& packet) override;
+        void OnRenderEnd() override;
         void AddRenderPasses(AZ::RPI::RenderPipeline* renderPipeline) override;
 
         // Internal methods for RmlUi context management
@@ -0,0 +1,292 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#include "TuRmlGeometryHeap.h"
+
+#include <AzCore/Console/ILogger.h>
+#include <AzCore/Math/MathUtils.h>
+#include <Atom/RPI.Public/Buffer/BufferSystemInterface.h>
+
+namespace TuRml
+{
+    float TuRmlGeometryHeap::Stats::GetFragmentation() const
+    {
+        const size_t freeBytes = reservedBytes - allocatedBytes;
+        if (freeBytes == 0)
+        {
+            return 0.0f;
+        }
+        return 1.0f - static_cast<float>(largestFreeBlock) / static_cast<float>(freeBytes);
+    }
+
+    void TuRmlGeometryHeap::Page::PushFree(uint32_t block, uint8_t order)
+    {
+        freeOrder[block] = order;
+        prev[block] = InvalidBlock;
+        next[block] = freeHeads[order];
+        if (freeHeads[order] != InvalidBlock)
+        {
+            prev[freeHeads[order]] = block;
+        }
+        freeHeads[order] = block;
+    }
+
+    void TuRmlGeometryHeap::Page::RemoveFree(uint32_t block)
+    {
+        const uint8_t order = freeOrder[block];
+        if (prev[block] != InvalidBlock)
+        {
+            next[prev[block]] = next[block];
+        }
+        else
+        {
+            freeHeads[order] = next[block];
+        }
+
+        if (next[block] != InvalidBlock)
+        {
+            prev[next[block]] = prev[block];
+        }
+        freeOrder[block] = NotFree;
+    }
+
+    uint32_t TuRmlGeometryHeap::Page::PopFree(uint8_t order)
+    {
+        const uint32_t block = freeHeads[order];
+        if (block != InvalidBlock)
+        {
+            RemoveFree(block);
+        }
+        return block;
+    }
+
+    TuRmlGeometryHeap::TuRmlGeometryHeap(const char* name, size_t elementSize)
+        : m_name(name)
+        , m_elementSize(elementSize)
+    {
+    }
+
+    TuRmlGeometryHeap::~TuRmlGeometryHeap()
+    {
+        for (const auto& page : m_pages)
+        {
+            AZ_Warning("TuRmlGeometryHeap", !page || page->allocationCount == 0,
+                       "%s still has %zu allocations on destruction", m_name.c_str(), page->allocationCount);
+        }
+    }
+
+    uint8_t TuRmlGeometryHeap::GetOrderForSize(size_t byteCount)
+    {
+        const size_t blockCount = (AZStd::max(byteCount, size_t(1)) + MinBlockSize - 1) / MinBlockSize;
+        uint8_t order = 0;
+        while ((size_t(1) << order) < blockCount)
+        {
+            ++order;
+        }
+        return order;
+    }
+
+    uint32_t TuRmlGeometryHeap::CreatePage(uint8_t maxOrder)
+    {
+        const uint32_t blockCount = 1u << maxOrder;
+        const size_t byteCount = size_t(MinBlockSize) * blockCount;
+
+        auto page = AZStd::make_unique<Page>();
+        page->maxOrder = maxOrder;
+        page->freeHeads.resize(maxOrder + 1, InvalidBlock);
+        page->next.resize(blockCount, InvalidBlock);
+        page->prev.resize(blockCount, InvalidBlock);
+        page->freeOrder.resize(blockCount, NotFree);
+
+        // Reuse a released slot so page indices stay small
+        uint32_t pageIndex = static_cast<uint32_t>(m_pages.size());
+        for (uint32_t i = 0; i < m_pages.size(); ++i)
+        {
+            if (!m_pages[i])
+            {
+                pageIndex = i;
+                break;
+            }
+        }
+
+        AZ::RPI::CommonBufferDescriptor desc;
+        desc.m_poolType = AZ::RPI::CommonBufferPoolType::DynamicInputAssembly;
+        desc.m_bufferName = AZStd::string::format("%s Page #%u", m_name.c_str(), pageIndex);
+        desc.m_byteCount = byteCount;
+        desc.m_elementSize = m_elementSize;
+        desc.m_bufferData = nullptr;
+
+        page->buffer = AZ::RPI::BufferSystemInterface::Get()->CreateBufferFromCommonPool(desc);
+        if (!page->buffer)
+        {
+            AZ_Error("TuRmlGeometryHeap", false, "Failed to create %zu byte page for %s", byteCount, m_name.c_str());
+            return InvalidPage;
+        }
+
+        page->PushFree(0, maxOrder);
+
+        if (pageIndex == m_pages.size())
+        {
+            m_pages.push_back(AZStd::move(page));
+        }
+        else
+        {
+            m_pages[pageIndex] = AZStd::move(page);
+        }
+
+        AZ_Info("TuRmlGeometryHeap", "%s allocated page #%u: %zu bytes", m_name.c_str(), pageIndex, byteCount);
+        return pageIndex;
+    }
+
+    bool TuRmlGeometryHeap::AllocateFromPage(uint32_t pageIndex, uint8_t order, Allocation& allocation)
+    {
+        Page& page = *m_pages[pageIndex];
+        if (order > page.maxOrder)
+        {
+            return false;
+        }
+
+        // Smallest free block that fits, then split it down to the requested order
+        uint8_t freeOrder = order;
+        while (freeOrder <= page.maxOrder && page.freeHeads[freeOrder] == InvalidBlock)
+        {
+            ++freeOrder;
+        }
+
+        if (freeOrder > page.maxOrder)
+        {
+            return false;
+        }
+
+        const uint32_t block = page.PopFree(freeOrder);
+        while (freeOrder > order)
+        {
+            --freeOrder;
+            page.PushFree(block + (1u << freeOrder), freeOrder);
+        }
+
+        allocation.pageIndex = pageIndex;
+        allocation.offset = block * MinBlockSize;
+        allocation.order = order;
+
+        ++page.allocationCount;
+        page.allocatedBytes += size_t(MinBlockSize) << order;
+        page.requestedBytes += allocation.size;
+        return true;
+    }
+
+    TuRmlGeometryHeap::Allocation TuRmlGeometryHeap::Allocate(size_t byteCount)
+    {
+        Allocation allocation;
+        allocation.size = static_cast<uint32_t>(byteCount);
+        const uint8_t order = GetOrderForSize(byteCount);
+
+        for (uint32_t pageIndex = 0; pageIndex < m_pages.size(); ++pageIndex)
+        {
+            if (m_pages[pageIndex] && AllocateFromPage(pageIndex, order, allocation))
+            {
+                return allocation;
+            }
+        }
+
+        // Oversized geometry gets a page of its own size
+        const uint32_t pageIndex = CreatePage(AZStd::max(order, DefaultPageOrder));
+        if (pageIndex == InvalidPage || !AllocateFromPage(pageIndex, order, allocation))
+        {
+            return {};
+        }
+        return allocation;
+    }
+
+    void TuRmlGeometryHeap::Free(const Allocation& allocation)
+    {
+        if (!allocation.IsValid() || allocation.pageIndex >= m_pages.size() || !m_pages[allocation.pageIndex])
+        {
+            return;
+        }
+
+        Page& page = *m_pages[allocation.pageIndex];
+        --page.allocationCount;
+        page.allocatedBytes -= size_t(MinBlockSize) << allocation.order;
+        page.requestedBytes -= allocation.size;
+
+        // Merge with the buddy for as long as it is free and of the same order
+        uint32_t block = allocation.offset / MinBlockSize;
+        uint8_t order = allocation.order;
+        while (order < page.maxOrder)
+        {
+            const uint32_t buddy = block ^ (1u << order);
+            if (page.freeOrder[buddy] != order)
+            {
+                break;
+            }
+            page.RemoveFree(buddy);
+            block = AZStd::min(block, buddy);
+            ++order;
+        }
+        page.PushFree(block, order);
+
+        if (m_releaseEmptyPages && page.allocationCount == 0)
+        {
+            size_t livePages = 0;
+            for (const auto& other : m_pages)
+            {
+                livePages += other ? 1 : 0;
+            }
+
+            if (livePages > 1)
+            {
+                AZ_Info("TuRmlGeometryHeap", "%s released empty page #%u", m_name.c_str(), allocation.pageIndex);
+                m_pages[allocation.pageIndex].reset();
+            }
+        }
+    }
+
+    bool TuRmlGeometryHeap::UpdateData(const Allocation& allocation, const void* data, size_t byteCount)
+    {
+        AZ_Assert(byteCount <= (size_t(MinBlockSize) << allocation.order), "Writing past the end of an allocation");
+        const auto& buffer = GetBuffer(allocation);
+        return buffer && buffer->UpdateData(data, byteCount, allocation.offset);
+    }
+
+    const AZ::Data::Instance<AZ::RPI::Buffer>& TuRmlGeometryHeap::GetBuffer(const Allocation& allocation) const
+    {
+        static const AZ::Data::Instance<AZ::RPI::Buffer> NullBuffer;
+        if (!allocation.IsValid() || allocation.pageIndex >= m_pages.size() || !m_pages[allocation.pageIndex])
+        {
+            return NullBuffer;
+        }
+        return m_pages[allocation.pageIndex]->buffer;
+    }
+
+    TuRmlGeometryHeap::Stats TuRmlGeometryHeap::GetStats() const
+    {
+        Stats stats;
+        for (const auto& page : m_pages)
+        {
+            if (!page)
+            {
+                continue;
+            }
+
+            ++stats.pageCount;
+            stats.allocationCount += page->allocationCount;
+            stats.reservedBytes += size_t(MinBlockSize) << page->maxOrder;
+            stats.allocatedBytes += page->allocatedBytes;
+            stats.requestedBytes += page->requestedBytes;
+
+            for (int order = page->maxOrder; order >= 0; --order)
+            {
+                if (page->freeHeads[order] != InvalidBlock)
+                {
+                    stats.largestFreeBlock = AZStd::max(stats.largestFreeBlock, size_t(MinBlockSize) << order);
+                    break;
+                }
+            }
+        }
+        return stats;
+    }
+}
@@ -0,0 +1,107 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#pragma once
+
+#include <AzCore/std/containers/vector.h>
+#include <AzCore/std/limits.h>
+#include <AzCore/std/smart_ptr/unique_ptr.h>
+#include <AzCore/std/string/string.h>
+#include <Atom/RPI.Public/Buffer/Buffer.h>
+
+#include <TuRml/Allocators.h>
+
+namespace TuRml
+{
+    //! Buddy allocator that sub-allocates geometry from a few large GPU buffers (pages).
+    //! Allocations are rounded up to a power of two multiple of MinBlockSize, freed blocks are merged
+    //! back with their buddy and pages that become completely free are released.
+    class TuRmlGeometryHeap
+    {
+    public:
+        AZ_CLASS_ALLOCATOR(TuRmlGeometryHeap, TuRmlRenderAllocator);
+
+        static constexpr uint32_t MinBlockSize = 64;
+        //! Default page is MinBlockSize << DefaultPageOrder bytes (1 MiB)
+        static constexpr uint8_t DefaultPageOrder = 14;
+        static constexpr uint32_t InvalidPage = AZStd::numeric_limits<uint32_t>::max();
+
+        struct Allocation
+        {
+            uint32_t pageIndex = InvalidPage;
+            //! Offset in bytes into the page's buffer
+            uint32_t offset = 0;
+            //! Bytes requested, the block itself is MinBlockSize << order
+            uint32_t size = 0;
+            uint8_t order = 0;
+
+            bool IsValid() const { return pageIndex != InvalidPage; }
+        };
+
+        struct Stats
+        {
+            size_t pageCount = 0;
+            size_t allocationCount = 0;
+            size_t reservedBytes = 0;
+            size_t allocatedBytes = 0;
+            size_t requestedBytes = 0;
+            size_t largestFreeBlock = 0;
+
+            //! 0 when all free space is one block, approaching 1 as it gets scattered
+            float GetFragmentation() const;
+        };
+
+        TuRmlGeometryHeap(const char* name, size_t elementSize);
+        ~TuRmlGeometryHeap();
+
+        Allocation Allocate(size_t byteCount);
+        void Free(const Allocation& allocation);
+
+        bool UpdateData(const Allocation& allocation, const void* data, size_t byteCount);
+        const AZ::Data::Instance<AZ::RPI::Buffer>& GetBuffer(const Allocation& allocation) const;
+
+        //! If set, pages that become empty are released, except for the last one.
+        void SetReleaseEmptyPages(bool release) { m_releaseEmptyPages = release; }
+
+        Stats GetStats() const;
+
+    private:
+        static constexpr uint32_t InvalidBlock = AZStd::numeric_limits<uint32_t>::max();
+        static constexpr uint8_t NotFree = 0xFF;
+
+        struct Page
+        {
+            AZ::Data::Instance<AZ::RPI::Buffer> buffer;
+            uint8_t maxOrder = 0;
+            size_t allocationCount = 0;
+            size_t allocatedBytes = 0;
+            size_t requestedBytes = 0;
+
+            //! Head of the free list for each order, in min blocks
+            AZStd::vector<uint32_t> freeHeads;
+            //! Per min block, only meaningful at the start of a free block
+            AZStd::vector<uint32_t> next;
+            AZStd::vector<uint32_t> prev;
+            AZStd::vector<uint8_t> freeOrder;
+
+            void PushFree(uint32_t block, uint8_t order);
+            void RemoveFree(uint32_t block);
+            uint32_t PopFree(uint8_t order);
+        };
+
+        static uint8_t GetOrderForSize(size_t byteCount);
+
+        uint32_t CreatePage(uint8_t maxOrder);
+        bool AllocateFromPage(uint32_t pageIndex, uint8_t order, Allocation& allocation);
+
+        AZStd::string m_name;
+        size_t m_elementSize = 0;
+        bool m_releaseEmptyPages = true;
+
+        // Released pages leave a null slot so page indices in live allocations stay valid
+        AZStd::vector<AZStd::unique_ptr<Page>> m_pages;
+    };
+}
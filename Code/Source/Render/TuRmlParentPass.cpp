@@ -5,11 +5,63 @@
  * For complete copyright and license terms please see the LICENSE at the root of this distribution.
  */
 #include "TuRmlParentPass.h"
+#include <AzCore/Console/IConsole.h>
 #include <AzCore/Name/Name.h>
+#include <AzCore/std/algorithm.h>
+#include <Atom/RHI/RHISystemInterface.h>
+#include <Atom/RPI.Public/Image/ImageSystemInterface.h>
 #include <Atom/RPI.Public/Pass/PassSystemInterface.h>
+#include <Atom/RPI.Reflect/Pass/PassRequest.h>
+#include <TuRml/TuRmlBus.h>
 
 namespace TuRml
 {
+    AZ_CVAR_EXTERNED(int, r_rmlMSAA);
+
+    static constexpr AZ::RHI::Format MSAADepthStencilFormat = TuRmlPipelineStateKey::DirectDepthStencilFormat;
+    // The RHI reports which formats can be render targets and depth stencils, but not at which sample counts.
+    // 4x is the one count Vulkan, DX12 and Metal all require for both, 2x and 8x are optional.
+    static constexpr uint16_t MaxGuaranteedSamples = 4;
+
+    // Rounded down to a sample count the device can render colorFormat and the depth stencil with.
+    // colorFormat is Unknown while the pipeline's target isn't known, only the sample count is checked then.
+    static uint16_t GetMSAASampleCount(AZ::RHI::Format colorFormat)
+    {
+        const int requested = AZStd::clamp(static_cast<int>(r_rmlMSAA), 1, 8);
+        if (requested < 2)
+        {
+            return 1;
+        }
+
+        uint16_t sampleCount = requested >= MaxGuaranteedSamples ? MaxGuaranteedSamples : 1;
+        const char* reason = "only 4x is supported on every device";
+        if (sampleCount > 1 && colorFormat != AZ::RHI::Format::Unknown)
+        {
+            AZ::RHI::Device* device = AZ::RHI::RHISystemInterface::Get()->GetDevice();
+            const bool colorSupported = device && AZ::RHI::CheckBitsAll(
+                device->GetFormatCapabilities(colorFormat), AZ::RHI::FormatCapabilities::RenderTarget);
+            const bool depthStencilSupported = device && AZ::RHI::CheckBitsAll(
+                device->GetFormatCapabilities(MSAADepthStencilFormat), AZ::RHI::FormatCapabilities::DepthStencil);
+            if (!colorSupported || !depthStencilSupported)
+            {
+                sampleCount = 1;
+                reason = "the device can't render to the target formats";
+            }
+        }
+
+        // Once per setting, this runs for every context
+        static int reportedRequest = 0;
+        static uint16_t reportedSampleCount = 0;
+        if (sampleCount != requested && (reportedRequest != requested || reportedSampleCount != sampleCount))
+        {
+            reportedRequest = requested;
+            reportedSampleCount = sampleCount;
+            AZ_Warning("TuRmlParentPass", false, "r_rmlMSAA %d isn't used, rendering with %ux: %s", requested,
+                       sampleCount, reason);
+        }
+        return sampleCount;
+    }
+
     AZ::RPI::Ptr<TuRmlParentPass> TuRmlParentPass::Create(const AZ::RPI::PassDescriptor& descriptor)
     {
         return aznew TuRmlParentPass(descriptor);
@@ -87,6 +139,8 @@ namespace TuRml
 
     void TuRmlParentPass::BuildInternal()
     {
+        WarmDirectPipelineStates();
+
         for (auto& [context, data] : m_contextPasses)
         {
             if (data.m_childPass == nullptr)
@@ -156,6 +210,16 @@ namespace TuRml
             return;
         }
 
+        m_contextPasses[context].m_sampleCount = 1;
+        AZ::RHI::Size size;
+        AZ::RHI::Format format = AZ::RHI::Format::Unknown;
+        GetDirectPipelineTarget(size, format);
+        if (const uint16_t sampleCount = GetMSAASampleCount(format);
+            sampleCount > 1 && AddMultisampledChildPassForContext(context, sampleCount))
+        {
+            return;
+        }
+
         auto contextName = context->GetName().c_str();
 
         AZStd::string passName = AZStd::string::format("TuRmlDirectPipelineChildPass_%s", contextName);
@@ -184,6 +248,193 @@ namespace TuRml
         }
     }
 
+    bool TuRmlParentPass::AddMultisampledChildPassForContext(Rml::Context* context, uint16_t sampleCount)
+    {
+        AZ::RHI::Size size;
+        AZ::RHI::Format format;
+        if (!GetDirectPipelineTarget(size, format))
+        {
+            return false;
+        }
+
+        // Not retried if creating it fails, only once r_rmlMSAA or the pipeline's size changes
+        ContextPassData& data = m_contextPasses[context];
+        data.m_sampleCount = sampleCount;
+
+        auto contextName = context->GetName().c_str();
+        AZ::RPI::AttachmentImagePool* imagePool = AZ::RPI::ImageSystemInterface::Get()->GetSystemAttachmentPool().get();
+        const AZ::RHI::MultisampleState multisampleState(sampleCount, 0);
+
+        AZ::RHI::ImageDescriptor colorDesc = AZ::RHI::ImageDescriptor::Create2D(
+            AZ::RHI::ImageBindFlags::Color | AZ::RHI::ImageBindFlags::ShaderRead, size.m_width, size.m_height, format);
+        colorDesc.m_multisampleState = multisampleState;
+        const AZ::RHI::ClearValue colorClearValue = AZ::RHI::ClearValue::CreateVector4Float(0.0f, 0.0f, 0.0f, 0.0f);
+
+        AZ::RPI::CreateAttachmentImageRequest colorRequest;
+        colorRequest.m_imageName = AZ::Name(AZStd::string::format("TuRmlContextMSAA_%p", context));
+        colorRequest.m_isUniqueName = false;
+        colorRequest.m_imageDescriptor = colorDesc;
+        colorRequest.m_optimizedClearValue = &colorClearValue;
+        colorRequest.m_imagePool = imagePool;
+        data.m_msaaColor = AZ::RPI::AttachmentImage::Create(colorRequest);
+
+        AZ::RHI::ImageDescriptor depthStencilDesc = AZ::RHI::ImageDescriptor::Create2D(
+            AZ::RHI::ImageBindFlags::DepthStencil, size.m_width, size.m_height, MSAADepthStencilFormat);
+        depthStencilDesc.m_multisampleState = multisampleState;
+        const AZ::RHI::ClearValue depthStencilClearValue = AZ::RHI::ClearValue::CreateDepthStencil(0.0f, 0);
+
+        AZ::RPI::CreateAttachmentImageRequest depthStencilRequest;
+        depthStencilRequest.m_imageName = AZ::Name(AZStd::string::format("TuRmlContextMSAADepthStencil_%p", context));
+        depthStencilRequest.m_isUniqueName = false;
+        depthStencilRequest.m_imageDescriptor = depthStencilDesc;
+        depthStencilRequest.m_optimizedClearValue = &depthStencilClearValue;
+        depthStencilRequest.m_imagePool = imagePool;
+        data.m_msaaDepthStencil = AZ::RPI::AttachmentImage::Create(depthStencilRequest);
+
+        if (!data.m_msaaColor || !data.m_msaaDepthStencil)
+        {
+            AZ_Error("TuRmlParentPass", false, "Failed to create %ux multisampled targets for context %s",
+                     sampleCount, contextName);
+            data.m_msaaColor = nullptr;
+            data.m_msaaDepthStencil = nullptr;
+            return false;
+        }
+
+        AZStd::string passName = AZStd::string::format("TuRmlDirectPipelineChildPass_%s", contextName);
+
+        AZ::RPI::PassSystemInterface* passSystem = AZ::RPI::PassSystemInterface::Get();
+        AZ::RPI::Ptr<TuRmlChildPass> childPass = azrtti_cast<TuRmlChildPass*>(
+            passSystem->CreatePassFromTemplate(AZ::Name("TuRmlChildPassDirectMSAATemplate"), AZ::Name(passName)).get()
+        );
+
+        // Resolves the child pass's samples onto the pipeline, the template connects its color output
+        AZ::RPI::PassRequest compositeRequest;
+        compositeRequest.m_templateName = AZ::Name("TuRmlMSAACompositeTemplate");
+        compositeRequest.m_passName = AZ::Name(AZStd::string::format("TuRmlMSAACompositePass_%s", contextName));
+        AZ::RPI::PassConnection uiConnection;
+        uiConnection.m_localSlot = AZ::Name("UIInput");
+        uiConnection.m_attachmentRef.m_pass = AZ::Name(passName);
+        uiConnection.m_attachmentRef.m_attachment = AZ::Name("ColorOutput");
+        compositeRequest.m_connections.push_back(uiConnection);
+        AZ::RPI::Ptr<AZ::RPI::Pass> compositePass = passSystem->CreatePassFromRequest(&compositeRequest);
+
+        if (!childPass || !compositePass)
+        {
+            AZ_Error("TuRmlParentPass", false, "Failed to create multisampled direct pipeline passes for context %s",
+                     contextName);
+            data.m_msaaColor = nullptr;
+            data.m_msaaDepthStencil = nullptr;
+            return false;
+        }
+
+        // Rendered like a render target, so retained mode and partial redraws work on the multisampled image too
+        childPass->UpdateRenderTarget(data.m_msaaColor, data.m_msaaDepthStencil);
+
+        AddChild(childPass);
+        AddChild(compositePass);
+        data.m_childPass = childPass;
+        data.m_compositePass = compositePass;
+        data.m_renderTarget = nullptr;
+        data.m_isDirectPipelineMode = true;
+
+        AZ_Info("TuRmlParentPass", "Created %ux multisampled direct pipeline child pass '%s' for context %s",
+                sampleCount, passName.c_str(), contextName);
+        return true;
+    }
+
+    bool TuRmlParentPass::GetDirectPipelineTarget(AZ::RHI::Size& size, AZ::RHI::Format& format)
+    {
+        const AZ::RPI::PassAttachmentBinding* binding = FindAttachmentBinding(AZ::Name("ColorInputOutput"));
+        if (!binding || !binding->GetAttachment())
+        {
+            return false;
+        }
+
+        const AZ::RHI::ImageDescriptor& desc = binding->GetAttachment()->m_descriptor.m_image;
+        size = desc.m_size;
+        format = desc.m_format;
+        return size.m_width > 0 && size.m_height > 0 && format != AZ::RHI::Format::Unknown;
+    }
+
+    void TuRmlParentPass::WarmDirectPipelineStates()
+    {
+        const AZ::RPI::PassAttachmentBinding* binding = FindAttachmentBinding(AZ::Name("ColorInputOutput"));
+        if (!binding || !binding->GetAttachment())
+        {
+            return;
+        }
+
+        TuRmlRenderInterface* renderInterface = nullptr;
+        TuRmlRequestBus::BroadcastResult(renderInterface, &TuRmlRequestBus::Events::GetRenderInterface);
+        if (!renderInterface)
+        {
+            return;
+        }
+
+        // Both direct outputs, so contexts switching to pipeline mode or to r_rmlMSAA don't build them mid frame
+        const AZ::RHI::ImageDescriptor& desc = binding->GetAttachment()->m_descriptor.m_image;
+        TuRmlPipelineStateCache& pipelineStateCache = renderInterface->GetPipelineStateCache();
+        pipelineStateCache.Warm(
+            TuRmlPipelineStateKey::ForDirectPipeline(desc.m_format, desc.m_multisampleState.m_samples));
+        if (const uint16_t sampleCount = GetMSAASampleCount(desc.m_format); sampleCount > 1)
+        {
+            pipelineStateCache.Warm(TuRmlPipelineStateKey::ForDirectPipeline(desc.m_format, sampleCount));
+        }
+    }
+
+    void TuRmlParentPass::UpdateMultisampleTargets()
+    {
+        AZ::RHI::Size size;
+        AZ::RHI::Format format;
+        const bool hasTarget = GetDirectPipelineTarget(size, format);
+        const uint16_t sampleCount = GetMSAASampleCount(hasTarget ? format : AZ::RHI::Format::Unknown);
+
+        bool rebuild = false;
+        for (auto& [context, data] : m_contextPasses)
+        {
+            if (!data.m_isDirectPipelineMode || !data.m_childPass)
+            {
+                continue;
+            }
+
+            bool stale = data.m_sampleCount != sampleCount;
+            if (data.m_msaaColor && hasTarget)
+            {
+                const AZ::RHI::ImageDescriptor& desc = data.m_msaaColor->GetDescriptor();
+                stale = stale || desc.m_size.m_width != size.m_width || desc.m_size.m_height != size.m_height ||
+                    desc.m_format != format;
+            }
+
+            // Multisampled targets can't be created before the pipeline's size is known
+            if (stale && (sampleCount == 1 || hasTarget))
+            {
+                RemoveContextPasses(data);
+                rebuild = true;
+            }
+        }
+
+        if (rebuild)
+        {
+            QueueForBuildAndInitialization();
+        }
+    }
+
+    void TuRmlParentPass::RemoveContextPasses(ContextPassData& data)
+    {
+        if (data.m_childPass)
+        {
+            RemoveChild(data.m_childPass);
+            data.m_childPass = nullptr;
+        }
+        if (data.m_compositePass)
+        {
+            RemoveChild(data.m_compositePass);
+            data.m_compositePass = nullptr;
+        }
+        data.m_msaaColor = nullptr;
+        data.m_msaaDepthStencil = nullptr;
+    }
+
     void TuRmlParentPass::RemoveChildPass(Rml::Context* context)
     {
         if (!context)
@@ -195,6 +446,10 @@ namespace TuRml
         if (it != m_contextPasses.end())
         {
             it->second.m_childPass->QueueForRemoval();
+            if (it->second.m_compositePass)
+            {
+                it->second.m_compositePass->QueueForRemoval();
+            }
             m_contextPasses.erase(it);
             return;
         }
@@ -218,11 +473,7 @@ namespace TuRml
         auto& contextData = m_contextPasses[context];
 
         // Remove existing child pass
-        if (contextData.m_childPass)
-        {
-            RemoveChild(contextData.m_childPass);
-            contextData.m_childPass = nullptr;
-        }
+        RemoveContextPasses(contextData);
 
         // Update mode and render target
         contextData.m_isDirectPipelineMode = isDirectPipeline;
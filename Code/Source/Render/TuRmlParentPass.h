@@ -20,6 +20,13 @@ namespace TuRml
         AZ::RPI::Ptr<TuRmlChildPass> m_childPass = nullptr;
         AZ::Data::Instance<AZ::RPI::AttachmentImage> m_renderTarget = nullptr;
         bool m_isDirectPipelineMode = false; // Track which mode this pass is in
+        // Multisampled direct pipeline mode: the child pass renders into these, the composite pass resolves them
+        // onto the pipeline
+        AZ::RPI::Ptr<AZ::RPI::Pass> m_compositePass = nullptr;
+        AZ::Data::Instance<AZ::RPI::AttachmentImage> m_msaaColor = nullptr;
+        AZ::Data::Instance<AZ::RPI::AttachmentImage> m_msaaDepthStencil = nullptr;
+        // r_rmlMSAA the direct pipeline passes were created for, 1 while the pipeline's size isn't known yet
+        uint16_t m_sampleCount = 1;
     };
 
     //! Parent pass that manages child passes for each RmlUi context
@@ -40,6 +47,10 @@ namespace TuRml
         //! Set context to direct pipeline mode (render directly to main pipeline)
         void SetDirectPipelineMode(Rml::Context* context);
 
+        //! Recreates direct pipeline passes whose multisampled targets don't match r_rmlMSAA or the pipeline's size
+        //! anymore, called once per frame before the child passes are looked up.
+        void UpdateMultisampleTargets();
+
         //! Removes the child pass for the given context.
         void RemoveChildPass(Rml::Context* context);
 
@@ -57,6 +68,15 @@ namespace TuRml
         void AddChildPassForContext(Rml::Context* context,
                                     AZ::Data::Instance<AZ::RPI::AttachmentImage> attachmentImage);
         void AddDirectPipelineChildPassForContext(Rml::Context* context);
+        //! Multisampled variant, false if its targets couldn't be created
+        bool AddMultisampledChildPassForContext(Rml::Context* context, uint16_t sampleCount);
+
+        //! Size and format of the pipeline's color, what multisampled targets are created with
+        bool GetDirectPipelineTarget(AZ::RHI::Size& size, AZ::RHI::Format& format);
+        //! Builds the pipeline states of the direct outputs once the pipeline's color is known
+        void WarmDirectPipelineStates();
+        //! Removes the context's passes from the hierarchy and drops its multisampled targets
+        void RemoveContextPasses(ContextPassData& data);
 
         //! Helper method to switch between direct pipeline and render target modes
         void SwitchContextMode(Rml::Context* context, bool isDirectPipeline,
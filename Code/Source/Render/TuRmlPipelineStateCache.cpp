@@ -0,0 +1,318 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#include "TuRmlPipelineStateCache.h"
+#include "../RmlBudget.h"
+
+#include <AzCore/Name/Name.h>
+#include <AzCore/std/hash.h>
+#include <AzCore/std/string/string.h>
+
+#include <Atom/RPI.Public/Pass/Pass.h>
+#include <Atom/RPI.Public/Pass/PassAttachment.h>
+#include <Atom/RPI.Public/RPIUtils.h>
+#include <Atom/RHI.Reflect/InputStreamLayoutBuilder.h>
+#include <Atom/RHI.Reflect/RenderAttachmentLayoutBuilder.h>
+
+namespace TuRml
+{
+    TuRmlPipelineStateKey TuRmlPipelineStateKey::FromPass(AZ::RPI::Pass* pass)
+    {
+        TuRmlPipelineStateKey key;
+        for (uint32_t i = 0; i < pass->GetAttachmentBindingCount(); ++i)
+        {
+            const AZ::RPI::PassAttachmentBinding& binding = pass->GetAttachmentBinding(i);
+            const AZ::RPI::PassAttachment* attachment = binding.GetAttachment().get();
+            if (attachment == nullptr)
+            {
+                continue;
+            }
+
+            const AZ::RHI::ImageDescriptor& image = attachment->m_descriptor.m_image;
+            if (binding.m_scopeAttachmentUsage == AZ::RHI::ScopeAttachmentUsage::RenderTarget &&
+                key.colorFormat == AZ::RHI::Format::Unknown)
+            {
+                key.colorFormat = image.m_format;
+                key.sampleCount = image.m_multisampleState.m_samples;
+            }
+            else if (binding.m_scopeAttachmentUsage == AZ::RHI::ScopeAttachmentUsage::DepthStencil)
+            {
+                key.depthStencilFormat = image.m_format;
+            }
+        }
+        return key;
+    }
+
+    TuRmlPipelineStateKey TuRmlPipelineStateKey::ForRenderTarget()
+    {
+        TuRmlPipelineStateKey key;
+        key.colorFormat = RenderTargetFormat;
+        return key;
+    }
+
+    TuRmlPipelineStateKey TuRmlPipelineStateKey::ForDirectPipeline(AZ::RHI::Format colorFormat, uint16_t sampleCount)
+    {
+        TuRmlPipelineStateKey key;
+        key.colorFormat = colorFormat;
+        key.depthStencilFormat = DirectDepthStencilFormat;
+        key.sampleCount = sampleCount;
+        return key;
+    }
+
+    AZ::RHI::RenderAttachmentConfiguration TuRmlPipelineStateKey::GetRenderAttachmentConfiguration() const
+    {
+        AZ::RHI::RenderAttachmentLayoutBuilder builder;
+        auto* subpass = builder.AddSubpass();
+        subpass->RenderTargetAttachment(colorFormat);
+        if (depthStencilFormat != AZ::RHI::Format::Unknown)
+        {
+            subpass->DepthStencilAttachment(depthStencilFormat);
+        }
+
+        AZ::RHI::RenderAttachmentConfiguration configuration;
+        builder.End(configuration.m_renderAttachmentLayout);
+        configuration.m_subpassIndex = 0;
+        return configuration;
+    }
+
+    size_t TuRmlPipelineStateCache::KeyHash::operator()(const TuRmlPipelineStateKey& key) const
+    {
+        size_t seed = 0;
+        AZStd::hash_combine(seed, static_cast<uint32_t>(key.colorFormat));
+        AZStd::hash_combine(seed, static_cast<uint32_t>(key.depthStencilFormat));
+        AZStd::hash_combine(seed, key.sampleCount);
+        return seed;
+    }
+
+    void TuRmlPipelineStateCache::Warm()
+    {
+        Warm(TuRmlPipelineStateKey::ForRenderTarget());
+    }
+
+    bool TuRmlPipelineStateCache::Warm(const TuRmlPipelineStateKey& key)
+    {
+        AZ_PROFILE_FUNCTION(RmlBudget);
+        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+        return FindOrCreate(key) != nullptr;
+    }
+
+    bool TuRmlPipelineStateCache::Acquire(AZ::RPI::Pass* pass, TuRmlPassPipelineStates& states)
+    {
+        AZ_PROFILE_FUNCTION(RmlBudget);
+        const TuRmlPipelineStateKey key = TuRmlPipelineStateKey::FromPass(pass);
+
+        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+        const size_t missCount = m_missCount;
+        const TuRmlPassPipelineStates* found = FindOrCreate(key);
+        if (!found)
+        {
+            return false;
+        }
+        if (m_missCount == missCount)
+        {
+            ++m_hitCount;
+        }
+        states = *found;
+        return true;
+    }
+
+    const TuRmlPassPipelineStates* TuRmlPipelineStateCache::FindOrCreate(const TuRmlPipelineStateKey& key)
+    {
+        if (auto it = m_states.find(key); it != m_states.end())
+        {
+            return &it->second;
+        }
+
+        if (!LoadShaders())
+        {
+            return nullptr;
+        }
+
+        ++m_missCount;
+        TuRmlPassPipelineStates& created = m_states[key];
+        CreatePipelineStates(created.standard, key, TuRmlVertexFormat{});
+        CreatePipelineStates(created.compact, key, TuRmlVertexFormat{ true });
+        created.clearStencil = CreateClearStencilPipelineState(key);
+        created.clearColor = CreateClearColorPipelineState(key);
+        AZ_Info("TuRmlPipelineStateCache", "Created pipeline states for format %u, depth stencil %u, %u samples",
+                static_cast<uint32_t>(key.colorFormat), static_cast<uint32_t>(key.depthStencilFormat),
+                static_cast<uint32_t>(key.sampleCount));
+        return &created;
+    }
+
+    AZ::Data::Instance<AZ::RPI::Shader> TuRmlPipelineStateCache::GetShader() const
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+        return m_shader;
+    }
+
+    TuRmlPipelineStateCache::Stats TuRmlPipelineStateCache::GetStats() const
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+        return { m_hitCount, m_missCount, m_states.size() };
+    }
+
+    bool TuRmlPipelineStateCache::LoadShaders()
+    {
+        if (!m_shader)
+        {
+            const char* shaderFilePath = "Shaders/TuRml/UIElement.azshader";
+            m_shader = AZ::RPI::LoadCriticalShader(shaderFilePath);
+            if (!m_shader)
+            {
+                AZ_Error("TuRmlPipelineStateCache", false, "Failed to load UIElement shader: %s", shaderFilePath);
+                return false;
+            }
+            AZ_Info("TuRmlPipelineStateCache", "Successfully loaded UIElement shader");
+        }
+
+        if (!m_clearShader)
+        {
+            const char* clearShaderPath = "Shaders/TuRml/ClearStencil.azshader";
+            m_clearShader = AZ::RPI::LoadCriticalShader(clearShaderPath);
+            if (!m_clearShader)
+            {
+                // Passes can still draw without it, clip masks just aren't cleared and partial redraws clear the
+                // whole render target
+                AZ_Error("TuRmlPipelineStateCache", false, "Failed to load clear stencil shader: %s", clearShaderPath);
+            }
+            else
+            {
+                AZ_Info("TuRmlPipelineStateCache", "Successfully loaded clear stencil shader");
+            }
+        }
+        return true;
+    }
+
+    AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> TuRmlPipelineStateCache::InitPipelineState(
+        const TuRmlVertexFormat& format)
+    {
+        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> ps = aznew AZ::RPI::PipelineStateForDraw;
+        ps->Init(m_shader);
+        AZ::RHI::InputStreamLayoutBuilder layoutBuilder;
+        layoutBuilder.AddBuffer()
+                     ->Channel("POSITION", format.GetPositionFormat())
+                     ->Channel("COLOR", AZ::RHI::Format::R8G8B8A8_UNORM)
+                     ->Channel("TEXCOORD0", format.GetTexCoordFormat());
+        ps->InputStreamLayout() = layoutBuilder.End();
+        ps->RenderStatesOverlay().m_depthStencilState.m_depth.m_enable = false;
+        return ps;
+    }
+
+    void TuRmlPipelineStateCache::FinishPipelineState(AZ::RPI::PipelineStateForDraw& ps,
+                                                      const TuRmlPipelineStateKey& key, const char* name)
+    {
+        // From the key rather than a pass, so outputs can be built before any pass renders to them
+        ps.RenderAttachmentConfigurationRef() = key.GetRenderAttachmentConfiguration();
+        ps.RenderStatesOverlay().m_multisampleState.m_samples = key.sampleCount;
+        ps.Finalize();
+        ps.GetRHIPipelineState()->GetDevicePipelineState(0)->SetName(AZ::Name(name));
+    }
+
+    void TuRmlPipelineStateCache::CreatePipelineStates(PipelineStates& states, const TuRmlPipelineStateKey& key,
+                                                       const TuRmlVertexFormat& format)
+    {
+        AZ_PROFILE_FUNCTION(RmlBudget);
+        const char* statesName = format.compactVertices ? "Compact" : "Standard";
+
+        const auto create = [&](const char* variant, bool stencilEnable, AZ::RHI::StencilOp passOp,
+                                AZ::RHI::ComparisonFunc func, bool writeColor)
+        {
+            AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> ps = InitPipelineState(format);
+
+            AZ::RHI::RenderStates& renderStates = ps->RenderStatesOverlay();
+            auto& stencilState = renderStates.m_depthStencilState.m_stencil;
+            stencilState.m_enable = stencilEnable;
+            stencilState.m_frontFace.m_failOp = AZ::RHI::StencilOp::Keep;
+            stencilState.m_frontFace.m_passOp = passOp;
+            stencilState.m_frontFace.m_depthFailOp = AZ::RHI::StencilOp::Keep;
+            stencilState.m_frontFace.m_func = func;
+            stencilState.m_writeMask = 0xFF;
+            stencilState.m_readMask = 0xFF;
+
+            stencilState.m_backFace = stencilState.m_frontFace;
+
+            if (!writeColor)
+            {
+                renderStates.m_blendState.m_targets[0].m_writeMask = 0; //No Color output
+            }
+
+            FinishPipelineState(*ps, key, AZStd::string::format("TuRml %s %s", statesName, variant).c_str());
+            return ps;
+        };
+
+        states.standard = create("Standard", false, AZ::RHI::StencilOp::Keep, AZ::RHI::ComparisonFunc::Equal, true);
+        states.standardStencilTest = create("StandardStencilTest", true, AZ::RHI::StencilOp::Keep,
+                                            AZ::RHI::ComparisonFunc::Equal, true);
+        states.CMO_Set = create("CMO_Set", true, AZ::RHI::StencilOp::Replace, AZ::RHI::ComparisonFunc::Always, false);
+        states.CMO_Intersect = create("CMO_Intersect", true, AZ::RHI::StencilOp::IncrementSaturate,
+                                      AZ::RHI::ComparisonFunc::Always, false);
+    }
+
+    AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> TuRmlPipelineStateCache::CreateClearStencilPipelineState(
+        const TuRmlPipelineStateKey& key)
+    {
+        if (!m_clearShader)
+        {
+            return nullptr;
+        }
+
+        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> ps = aznew AZ::RPI::PipelineStateForDraw;
+        ps->Init(m_clearShader);
+
+        AZ::RHI::InputStreamLayoutBuilder layoutBuilder;
+        // Fullscreen triangle generated in vertex shader
+        ps->InputStreamLayout() = layoutBuilder.End();
+
+        AZ::RHI::RenderStates& renderStates = ps->RenderStatesOverlay();
+
+        renderStates.m_depthStencilState.m_depth.m_enable = false;
+
+        auto& stencilState = renderStates.m_depthStencilState.m_stencil;
+        stencilState.m_enable = true;
+        stencilState.m_frontFace.m_failOp = AZ::RHI::StencilOp::Replace;
+        stencilState.m_frontFace.m_passOp = AZ::RHI::StencilOp::Replace;
+        stencilState.m_frontFace.m_depthFailOp = AZ::RHI::StencilOp::Replace;
+        stencilState.m_frontFace.m_func = AZ::RHI::ComparisonFunc::Always;
+        stencilState.m_writeMask = 0xFF;
+        stencilState.m_readMask = 0xFF;
+        stencilState.m_backFace = stencilState.m_frontFace;
+
+        AZ::RHI::TargetBlendState& blendState = renderStates.m_blendState.m_targets[0];
+        blendState.m_writeMask = 0;
+
+        FinishPipelineState(*ps, key, "TuRml ClearStencil");
+        return ps;
+    }
+
+    AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> TuRmlPipelineStateCache::CreateClearColorPipelineState(
+        const TuRmlPipelineStateKey& key)
+    {
+        if (!m_clearShader)
+        {
+            return nullptr;
+        }
+
+        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> ps = aznew AZ::RPI::PipelineStateForDraw;
+        ps->Init(m_clearShader);
+
+        AZ::RHI::InputStreamLayoutBuilder layoutBuilder;
+        // Fullscreen triangle generated in vertex shader
+        ps->InputStreamLayout() = layoutBuilder.End();
+
+        AZ::RHI::RenderStates& renderStates = ps->RenderStatesOverlay();
+        renderStates.m_depthStencilState.m_depth.m_enable = false;
+        renderStates.m_depthStencilState.m_stencil.m_enable = false;
+
+        // Replaces what's in the render target, blending would keep the old contents under the transparent output
+        AZ::RHI::TargetBlendState& blendState = renderStates.m_blendState.m_targets[0];
+        blendState.m_enable = false;
+        blendState.m_writeMask = 0xF;
+
+        FinishPipelineState(*ps, key, "TuRml ClearColor");
+        return ps;
+    }
+}
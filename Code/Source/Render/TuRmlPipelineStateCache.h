@@ -0,0 +1,155 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#pragma once
+
+#include <AzCore/std/containers/unordered_map.h>
+#include <AzCore/std/parallel/mutex.h>
+#include <Atom/RHI.Reflect/Format.h>
+#include <Atom/RHI.Reflect/RenderAttachmentLayout.h>
+#include <Atom/RPI.Public/Base.h>
+#include <Atom/RPI.Public/PipelineState.h>
+#include <Atom/RPI.Public/Shader/Shader.h>
+
+#include <RmlUi/Core/RenderInterface.h>
+
+#include <TuRml/Allocators.h>
+
+#include "TuRmlVertexFormat.h"
+
+namespace AZ::RPI
+{
+    class Pass;
+}
+
+namespace TuRml
+{
+    struct PipelineStates
+    {
+        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> standard;
+        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> standardStencilTest;
+        //The following pipeline states are for Rml::ClipMaskOperation
+        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> CMO_Set;
+        //For SetInverse use Set
+        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> CMO_Intersect;
+
+        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> GetPipelineStateForClipMaskOp(
+            const Rml::ClipMaskOperation operation)
+        {
+            switch (operation)
+            {
+            case Rml::ClipMaskOperation::SetInverse:
+            case Rml::ClipMaskOperation::Set:
+                return CMO_Set;
+            case Rml::ClipMaskOperation::Intersect:
+                return CMO_Intersect;
+            default:
+                return standard;
+            }
+        }
+    };
+
+    //! Every pipeline state a child pass draws with
+    struct TuRmlPassPipelineStates
+    {
+        PipelineStates standard;
+        //! Same states with the input layout of TuRmlCompactVertex
+        PipelineStates compact;
+        //! Resets the stencil buffer with a fullscreen triangle
+        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> clearStencil;
+        //! Writes transparent black with blending off, clears the damage of a partial redraw
+        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> clearColor;
+    };
+
+    //! The output a child pass renders to, passes with the same one can draw with the same pipeline states
+    struct TuRmlPipelineStateKey
+    {
+        //! Context render targets, see TuRmlFeatureProcessor::CreateRenderTarget
+        static constexpr AZ::RHI::Format RenderTargetFormat = AZ::RHI::Format::R8G8B8A8_UNORM;
+        //! TuRmlPassTemplate's depth stencil, also used by the multisampled targets
+        static constexpr AZ::RHI::Format DirectDepthStencilFormat = AZ::RHI::Format::D32_FLOAT_S8X24_UINT;
+
+        AZ::RHI::Format colorFormat = AZ::RHI::Format::Unknown;
+        AZ::RHI::Format depthStencilFormat = AZ::RHI::Format::Unknown;
+        uint16_t sampleCount = 1;
+
+        //! Read from the pass's render target and depth stencil bindings, they have to be connected
+        static TuRmlPipelineStateKey FromPass(AZ::RPI::Pass* pass);
+        //! A child pass rendering into a context render target
+        static TuRmlPipelineStateKey ForRenderTarget();
+        //! A child pass rendering onto the pipeline's color, or into a multisampled target resolved onto it
+        static TuRmlPipelineStateKey ForDirectPipeline(AZ::RHI::Format colorFormat, uint16_t sampleCount);
+
+        //! The attachment layout pipeline states for this output are built against
+        AZ::RHI::RenderAttachmentConfiguration GetRenderAttachmentConfiguration() const;
+
+        bool operator==(const TuRmlPipelineStateKey& rhs) const
+        {
+            return colorFormat == rhs.colorFormat && depthStencilFormat == rhs.depthStencilFormat &&
+                sampleCount == rhs.sampleCount;
+        }
+    };
+
+    //! Pipeline states shared by all child passes, keyed by the output they render to.
+    //! All variants of an output are built at once from its attachment layout, ahead of time for the outputs that
+    //! are known (Warm) or by the first pass rendering to it. Passes created later and passes switching between
+    //! render target and pipeline mode find them here instead of building their own.
+    class TuRmlPipelineStateCache
+    {
+    public:
+        AZ_CLASS_ALLOCATOR(TuRmlPipelineStateCache, TuRmlRenderAllocator);
+
+        struct Stats
+        {
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t outputCount = 0;
+        };
+
+        //! Loads the shaders and builds the context render target output ahead of the first pass, so it doesn't stall
+        //! on them. Called when the gem activates.
+        void Warm();
+        //! Builds the pipeline states of an output ahead of the first pass rendering to it, e.g. from a loading screen
+        //! or once the pipeline's format is known. Returns false if the shaders failed to load.
+        bool Warm(const TuRmlPipelineStateKey& key);
+
+        //! Copies the pass's pipeline states into states, building them on the first request for its output.
+        //! Returns false if the shaders failed to load.
+        bool Acquire(AZ::RPI::Pass* pass, TuRmlPassPipelineStates& states);
+
+        //! The UIElement shader the pipeline states are built from, null until Warm or Acquire loaded it
+        AZ::Data::Instance<AZ::RPI::Shader> GetShader() const;
+
+        Stats GetStats() const;
+
+    private:
+        struct KeyHash
+        {
+            size_t operator()(const TuRmlPipelineStateKey& key) const;
+        };
+
+        // All expect m_mutex to be held
+        bool LoadShaders();
+        // Finds or builds the entry for key, null if the shaders failed to load
+        const TuRmlPassPipelineStates* FindOrCreate(const TuRmlPipelineStateKey& key);
+        void CreatePipelineStates(PipelineStates& states, const TuRmlPipelineStateKey& key,
+                                  const TuRmlVertexFormat& format);
+        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> CreateClearStencilPipelineState(const TuRmlPipelineStateKey& key);
+        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> CreateClearColorPipelineState(const TuRmlPipelineStateKey& key);
+
+        // A UIElement pipeline state with the input layout of format, its render states are left to the caller
+        AZ::RPI::Ptr<AZ::RPI::PipelineStateForDraw> InitPipelineState(const TuRmlVertexFormat& format);
+        static void FinishPipelineState(AZ::RPI::PipelineStateForDraw& ps, const TuRmlPipelineStateKey& key,
+                                        const char* name);
+
+        mutable AZStd::mutex m_mutex;
+        AZ::Data::Instance<AZ::RPI::Shader> m_shader;
+        AZ::Data::Instance<AZ::RPI::Shader> m_clearShader;
+        AZStd::unordered_map<TuRmlPipelineStateKey, TuRmlPassPipelineStates, KeyHash> m_states;
+        size_t m_hitCount = 0;
+        size_t m_missCount = 0;
+    };
+}
@@ -7,9 +7,18 @@
 #include "TuRmlRenderInterface.h"
 #include "RmlBudget.h"
 #include "TuRmlChildPass.h"
+#include "TuRmlContextRenderInterface.h"
 
 #include <AzCore/Console/ILogger.h>
+#include <AzCore/Console/IConsole.h>
 #include <AzCore/Asset/AssetCommon.h>
+#include <AzCore/Jobs/JobFunction.h>
+#include <AzCore/Math/MathUtils.h>
+#include <AzCore/Math/SimdMath.h>
+#include <AzCore/Math/Vector4.h>
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/limits.h>
+#include <AzCore/std/sort.h>
 #include <Atom/RPI.Reflect/Buffer/BufferAssetCreator.h>
 #include <Atom/RPI.Public/Buffer/Buffer.h>
 #include <Atom/RPI.Public/Image/ImageSystemInterface.h>
@@ -17,6 +26,11 @@
 #include <Atom/RHI/IndexBufferView.h>
 
 #include <RmlUi/Core/Context.h>
+#include <RmlUi/Core/Core.h>
+#include <RmlUi/Core/ElementDocument.h>
+#include <RmlUi/Core/StringUtilities.h>
+#include <RmlUi/Core/SystemInterface.h>
+#include <RmlUi/Core/URL.h>
 
 #include <imgui/imgui.h>
 #include <TuRml/TuRmlFeatureProcessorInterface.h>
@@ -26,36 +40,81 @@
 
 namespace TuRml
 {
-    void TuRmlStoredGeometry::ReleaseGeometry(Rml::CompiledGeometryHandle geoId)
+    AZ_CVAR(bool, r_rmlBatching, true, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Merge consecutive TuRml draw commands with identical state into a single draw");
+    AZ_CVAR(int, r_rmlBatchMaxVertices, 1024, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Geometry with more vertices than this is never batched, persistent geometry below it keeps a CPU copy");
+    AZ_CVAR(bool, r_rmlGeometryHeapReleaseEmptyPages, true, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Release persistent geometry heap pages once all their geometry is freed");
+    AZ_CVAR(bool, r_rmlTextureAtlas, true, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Pack small generated textures into shared atlas pages");
+    AZ_CVAR(int, r_rmlTextureAtlasMaxSize, 256, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Generated textures wider or taller than this get their own image instead of going into the atlas");
+    AZ_CVAR(int, r_rmlTextureCacheLingerTicks, 120, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Ticks an unused file texture stays cached, so RmlUi releasing and reloading it doesn't restart the load");
+    AZ_CVAR(bool, r_rmlGeometryDedup, true, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Share resident geometry between identical CompileGeometry calls instead of storing it again");
+    AZ_CVAR(int, r_rmlGeometryPoolMaxBytes, 8 * 1024 * 1024, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Bytes of idle geometry CPU buffers kept for reuse, separately for vertices and indices");
+    AZ_CVAR(int, r_rmlFramesInFlight, 3, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Frames the GPU may be behind TuRml (2 or 3), released geometry, textures and ring space wait this long");
+    AZ_CVAR(bool, r_rmlParallelContextRecording, false, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Record contexts with their own render interface on separate jobs. Rml::Context::Render still runs one "
+            "context at a time, only the draw list processing after it (reordering, batching, buffer writes) overlaps");
+    AZ_CVAR(bool, r_rmlAnalyticAA, false, nullptr, AZ::ConsoleFunctorFlags::DontReplicate,
+            "Anti-alias sloped and curved edges with a fringe fading out over a pixel instead of relying on MSAA, "
+            "applies to geometry compiled after it changes");
+
+    // Context pixels the analytic anti-aliasing fringe reaches past an edge
+    static constexpr float FeatherWidth = 1.0f;
+
+    // 64 bit multiply-xorshift over whole words, the tail is folded in byte by byte
+    static AZ::u64 HashBytes(const void* data, size_t byteCount, AZ::u64 hash)
     {
-        auto geometry = reinterpret_cast<TuRmlStoredGeometry*>(geoId);
-
-        if (geometry->storageType == StorageType::Persistent)
+        constexpr AZ::u64 Multiplier = 0x9E3779B97F4A7C15ull;
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        size_t offset = 0;
+        for (; offset + sizeof(AZ::u64) <= byteCount; offset += sizeof(AZ::u64))
         {
-            if (geometry->vertexBuffer)
-            {
-                geometry->vertexBuffer->inUse = false;
-            }
-            if (geometry->indexBuffer)
-            {
-                geometry->indexBuffer->inUse = false;
-            }
+            AZ::u64 word;
+            memcpy(&word, bytes + offset, sizeof(word));
+            hash = (hash ^ word) * Multiplier;
+            hash ^= hash >> 32;
+        }
+        for (; offset < byteCount; ++offset)
+        {
+            hash = (hash ^ bytes[offset]) * Multiplier;
         }
+        return hash ^ (hash >> 29);
+    }
 
-        // Transient geometry doesn't own buffers, just clear views
-        geometry->vertexBufferView = {};
-        geometry->indexBufferView = {};
-        delete geometry;
+    bool TuRmlStoredGeometry::HasData() const
+    {
+        return vertexCount > 0 && indexCount > 0 && !vertices.empty() && !indices.empty();
     }
 
     TuRmlRenderInterface::TuRmlRenderInterface()
+        : m_vertexHeap("TuRml Vertex Heap", sizeof(Rml::Vertex))
+        , m_indexHeap("TuRml Index Heap", sizeof(int))
     {
+        m_defaultContextInterface = AZStd::make_unique<TuRmlContextRenderInterface>(*this);
         ImGui::ImGuiUpdateListenerBus::Handler::BusConnect();
     }
 
     TuRmlRenderInterface::~TuRmlRenderInterface()
     {
         ImGui::ImGuiUpdateListenerBus::Handler::BusDisconnect();
+        WaitForDrawLists();
+        ProcessReleases(0);
+        m_defaultTextureSrg.reset();
+
+        // RmlUi has released its textures by now, what's left are lingering and preloaded ones
+        for (auto& [path, texture] : m_fileTextures)
+        {
+            DestroyTexture(texture->handle);
+        }
+        m_fileTextures.clear();
+        m_placeholderImage.reset();
 
         const AZ::u64 texturesLeft = m_textureCreationCount;
         AZ_Error("TuRmlRenderInterface", texturesLeft == 0, "Still %zu textures left", texturesLeft);
@@ -63,228 +122,765 @@ namespace TuRml
         AZ_Info("TuRmlRenderInterface", "Destroyed render interface and released all resources");
     }
 
-    void TuRmlRenderInterface::Begin(Rml::Context* ctx, TuRmlChildPass* pass)
+    Rml::Context* TuRmlRenderInterface::CreateContext(const Rml::String& name, Rml::Vector2i dimensions)
     {
-        AZ_Assert(m_pass == nullptr, "Begin already called!");
-        // Clear any previous draw commands to start fresh
-        m_createdThisFrame.clear();
-        m_pass = pass;
-        GetDrawCommands().clear();
-
-        m_transform = AZ::Matrix4x4::CreateIdentity();
+        AZStd::lock_guard<AZStd::mutex> lock(m_contextInterfaceMutex);
 
-        const Rml::Vector2i dia = ctx->GetDimensions();
+        // RmlUi keeps a render manager per render interface until shutdown, so ones of destroyed contexts get reused
+        TuRmlContextRenderInterface* contextInterface = nullptr;
+        for (const auto& candidate : m_contextInterfaces)
+        {
+            if (!candidate->GetContext())
+            {
+                contextInterface = candidate.get();
+                break;
+            }
+        }
+        if (!contextInterface)
+        {
+            contextInterface = m_contextInterfaces.emplace_back(
+                AZStd::make_unique<TuRmlContextRenderInterface>(*this)).get();
+        }
 
-        auto ortho = Rml::Matrix4f::ProjectOrtho(
-            0.0f,
-            static_cast<float>(dia.x),
-            static_cast<float>(dia.y),
-            0.0f,
-            -1000, 1000);
+        Rml::Context* context = Rml::CreateContext(name, dimensions, contextInterface);
+        contextInterface->SetContext(context);
+        return context;
+    }
 
-        m_contextTransform = AZ::Matrix4x4::CreateFromColumnMajorFloat16(reinterpret_cast<const float*>(&ortho));
+    TuRmlContextRenderInterface& TuRmlRenderInterface::GetContextRenderInterface(Rml::Context* context)
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_contextInterfaceMutex);
+        for (const auto& contextInterface : m_contextInterfaces)
+        {
+            if (context && contextInterface->GetContext() == context)
+            {
+                return *contextInterface;
+            }
+        }
+        return *m_defaultContextInterface;
+    }
 
-        m_stencilRef = 1;
-        SetTransform(nullptr);
+    int TuRmlRenderInterface::GetEventClasses()
+    {
+        return EVT_BASIC;
     }
 
-    void TuRmlRenderInterface::End()
+    void TuRmlRenderInterface::OnContextDestroy(Rml::Context* context)
     {
-        AZ_PROFILE_FUNCTION(RmlBudget);
+        AZStd::lock_guard<AZStd::mutex> lock(m_contextInterfaceMutex);
+        for (const auto& contextInterface : m_contextInterfaces)
+        {
+            if (contextInterface->GetContext() == context)
+            {
+                contextInterface->SetContext(nullptr);
+            }
+        }
+    }
 
-        // Detect transient geometry: geometry created AND queued for release in the same frame
-        const auto& queuedFreeGeos = m_pass->m_drawCommands.Get().queuedFreeGeos;
+    void TuRmlRenderInterface::RecordDrawListsAsync(AZStd::vector<AZ::RPI::Ptr<TuRmlChildPass>> passes)
+    {
+        WaitForDrawLists();
+        if (passes.empty())
+        {
+            return;
+        }
 
-        for (auto handle : queuedFreeGeos)
+        // Passes sharing a render interface record one after another, it only tracks one draw list at a time
+        AZStd::vector<AZStd::vector<AZ::RPI::Ptr<TuRmlChildPass>>> groups;
+        if (r_rmlParallelContextRecording)
         {
-            // If this geometry was created this frame AND is being released, it's transient
-            if (m_createdThisFrame.contains(handle))
+            AZStd::vector<TuRmlContextRenderInterface*> groupInterfaces;
+            for (auto& pass : passes)
             {
-                auto* geo = GetStoredGeometry(handle);
-                if (geo && geo->storageType == TuRmlStoredGeometry::StorageType::Undecided)
+                TuRmlContextRenderInterface* contextInterface = &GetContextRenderInterface(pass->GetRmlContext());
+                auto it = AZStd::find(groupInterfaces.begin(), groupInterfaces.end(), contextInterface);
+                if (it == groupInterfaces.end())
                 {
-                    geo->storageType = TuRmlStoredGeometry::StorageType::Transient;
+                    groupInterfaces.push_back(contextInterface);
+                    groups.emplace_back();
+                    it = groupInterfaces.end() - 1;
                 }
+                groups[it - groupInterfaces.begin()].push_back(AZStd::move(pass));
             }
         }
+        else
+        {
+            groups.push_back(AZStd::move(passes));
+        }
 
-        auto& drawCmds = GetDrawCommands();
+        AZStd::lock_guard<AZStd::mutex> lock(m_drawListMutex);
+        m_drawListCompletion.Reset(true);
+        for (auto& group : groups)
+        {
+            AZ::Job* job = AZ::CreateJobFunction(
+                [group = AZStd::move(group)]()
+                {
+                    AZ_PROFILE_SCOPE(RmlBudget, "TuRml Draw Lists");
+                    for (const auto& pass : group)
+                    {
+                        pass->RecordDrawCommandsAhead();
+                    }
+                },
+                true);
+            job->SetDependent(&m_drawListCompletion);
+            job->Start();
+        }
+        m_drawListsPending = true;
+        ++m_asyncDrawListCount;
+        m_lastDrawListJobCount = groups.size();
+    }
 
-        // Mark any remaining Undecided geometry as Persistent
-        for (const auto& cmd : drawCmds)
+    void TuRmlRenderInterface::WaitForDrawLists()
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_drawListMutex);
+        if (m_drawListsPending)
         {
-            auto* geo = GetStoredGeometry(cmd.drawCommand.geometryHandle);
-            if (geo && geo->storageType == TuRmlStoredGeometry::StorageType::Undecided)
-            {
-                geo->storageType = TuRmlStoredGeometry::StorageType::Persistent;
-            }
+            AZ_PROFILE_SCOPE(RmlBudget, "TuRml Wait For Draw Lists");
+            m_drawListCompletion.StartAndWaitForCompletion();
+            m_drawListsPending = false;
         }
+    }
+
+    uint32_t TuRmlRenderInterface::GetFramesInFlight()
+    {
+        return static_cast<uint32_t>(AZStd::clamp(static_cast<int>(r_rmlFramesInFlight), 2,
+                                                  static_cast<int>(TuRmlRingBuffer::MaxFramesInFlight)));
+    }
+
+    void TuRmlRenderInterface::AdvanceFrame()
+    {
+        ++m_frameNumber;
 
-        AllocateGPUBuffers();
+        const auto poolMaxBytes = static_cast<size_t>(AZStd::max(static_cast<int>(r_rmlGeometryPoolMaxBytes), 0));
+        m_vertexPool.SetMaxIdleBytes(poolMaxBytes);
+        m_indexPool.SetMaxIdleBytes(poolMaxBytes);
+    }
 
-        m_pass = nullptr;
+    void TuRmlRenderInterface::OnFinishedFrame()
+    {
+        // Recording resolves geometry that's about to be destroyed
+        WaitForDrawLists();
+        ProcessReleases(GetFramesInFlight());
     }
 
-    void TuRmlRenderInterface::OnFinishedFrame(TuRmlChildPass* pass, AZ::u8 idx)
+    void TuRmlRenderInterface::QueueRelease(PendingRelease::Type type, uintptr_t handle)
     {
-        for (const auto& cmd : pass->m_drawCommands.Get(idx).drawCmds)
+        AZStd::lock_guard<AZStd::mutex> lock(m_releaseMutex);
+        m_pendingReleases.push_back({ type, handle, m_frameNumber });
+        ++m_deferredReleaseCount;
+    }
+
+    void TuRmlRenderInterface::ProcessReleases(uint32_t framesInFlight)
+    {
+        AZ_PROFILE_FUNCTION(RmlBudget);
+
+        // Destroying calls back into the slot maps and heaps, so the due releases are taken out first
+        AZStd::vector<PendingRelease> due;
         {
-            auto it = m_destroyedGeometries.find(cmd.drawCommand.geometryHandle);
-            if (it != m_destroyedGeometries.end())
+            AZStd::lock_guard<AZStd::mutex> lock(m_releaseMutex);
+            const AZ::u64 frameNumber = m_frameNumber;
+            while (!m_pendingReleases.empty() &&
+                   (framesInFlight == 0 || m_pendingReleases.front().frame + framesInFlight <= frameNumber))
             {
-                TuRmlStoredGeometry::ReleaseGeometry(*it);
-                m_destroyedGeometries.erase(it);
+                due.push_back(m_pendingReleases.front());
+                m_pendingReleases.pop_front();
             }
         }
-    }
 
-    TuRmlStoredGeometry* TuRmlRenderInterface::GetStoredGeometry(Rml::CompiledGeometryHandle handle)
-    {
-        if (!handle)
+        for (const PendingRelease& release : due)
         {
-            return nullptr;
+            if (release.type == PendingRelease::Type::Geometry)
+            {
+                DestroyGeometry(release.handle);
+            }
+            else if (release.type == PendingRelease::Type::Texture)
+            {
+                DestroyTexture(release.handle);
+            }
+            // Atlas pages only hold references, they're dropped along with due
         }
-
-        return reinterpret_cast<TuRmlStoredGeometry*>(handle);
     }
 
-    const TuRmlStoredTexture* TuRmlRenderInterface::GetStoredTexture(Rml::TextureHandle handle)
+    void TuRmlRenderInterface::DestroyGeometry(Rml::CompiledGeometryHandle handle)
     {
-        if (!handle)
+        auto* geometry = GetStoredGeometry(handle);
+        if (!geometry)
         {
-            return nullptr;
+            return;
+        }
+
+        {
+            AZStd::lock_guard<AZStd::mutex> lock(m_geometryMutex);
+            RemoveFromDedupCache(*geometry);
+
+            // Transient geometry doesn't own anything in the heaps
+            if (geometry->storageType == TuRmlStoredGeometry::StorageType::Persistent)
+            {
+                m_vertexHeap.SetReleaseEmptyPages(r_rmlGeometryHeapReleaseEmptyPages);
+                m_indexHeap.SetReleaseEmptyPages(r_rmlGeometryHeapReleaseEmptyPages);
+                m_vertexHeap.Free(geometry->vertexAllocation);
+                m_indexHeap.Free(geometry->indexAllocation);
+            }
         }
 
-        return reinterpret_cast<TuRmlStoredTexture*>(handle);
+        m_vertexPool.Release(geometry->vertices);
+        m_indexPool.Release(geometry->indices);
+        m_geometries.Remove(handle);
     }
 
-#pragma region Rml::RenderInterface
-    Rml::CompiledGeometryHandle TuRmlRenderInterface::CompileGeometry(Rml::Span<const Rml::Vertex> vertices,
-                                                                      Rml::Span<const int> indices)
+    TuRmlStoredGeometry* TuRmlRenderInterface::GetStoredGeometry(Rml::CompiledGeometryHandle handle)
     {
-        if (vertices.empty() || indices.empty())
-        {
-            return 0;
-        }
+        return m_geometries.Get(handle);
+    }
 
-        auto* storedGeo = aznew TuRmlStoredGeometry();
+    const TuRmlStoredTexture* TuRmlRenderInterface::GetStoredTexture(Rml::TextureHandle handle) const
+    {
+        return m_textures.Get(handle);
+    }
 
-        storedGeo->vertices.assign(vertices.begin(), vertices.end());
-        storedGeo->indices.assign(indices.begin(), indices.end());
-        storedGeo->indexCount = static_cast<uint32_t>(indices.size());
+    void TuRmlRenderInterface::ResolveTextures(FrameInfo& frameInfo)
+    {
+        AZ_PROFILE_FUNCTION(RmlBudget);
+        const AZ::Data::Instance<AZ::RPI::Shader> shader = m_pipelineStateCache.GetShader();
 
-        storedGeo->storageType = TuRmlStoredGeometry::StorageType::Undecided;
-        storedGeo->creatorPass = m_pass;
+        AZStd::lock_guard<AZStd::mutex> lock(m_textureSrgMutex);
+        // Frames resolved earlier keep the old page images until they retire, their UVs match those
+        if (m_textureAtlas.UpdatePageImages())
+        {
+            ++m_textureGeneration;
+        }
+        QueueAtlasPageReleases();
 
-        auto handle = reinterpret_cast<Rml::CompiledGeometryHandle>(storedGeo);
+        // Consecutive draws mostly share a texture, only look it up when it changes
+        Rml::TextureHandle lastTexture = 0;
+        AZ::RPI::ShaderResourceGroup* lastSrg = nullptr;
+        AZ::Vector4 lastUvRect = AZ::Vector4(0.0f, 0.0f, 1.0f, 1.0f);
+        for (TuRmlChildPassDrawCommand& cmd : frameInfo.drawCmds)
+        {
+            if (!shader || cmd.drawCommand.drawType == TuRmlDrawCommand::DrawType::ClearClipmask)
+            {
+                continue;
+            }
 
-        m_createdThisFrame.insert(handle);
+            if (!lastSrg || cmd.drawCommand.texture != lastTexture)
+            {
+                lastTexture = cmd.drawCommand.texture;
+                lastSrg = GetTextureSrg(lastTexture, shader);
+                lastUvRect = GetTextureUvRect(lastTexture);
+            }
+            cmd.textureSrg = lastSrg;
+            cmd.drawCommand.uvRect = lastUvRect;
+        }
 
-        return handle;
+        // Sampled with the lock held, a texture change after this makes the frame unusable for reuse
+        frameInfo.textureGeneration = m_textureGeneration;
     }
 
-    void TuRmlRenderInterface::RenderGeometry(Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation,
-                                              Rml::TextureHandle texture)
+    void TuRmlRenderInterface::QueueAtlasPageReleases()
     {
-        if (!geometry)
+        AZStd::vector<TuRmlTextureAtlas::Page> retiredPages = m_textureAtlas.TakeRetiredPages();
+        if (retiredPages.empty())
         {
             return;
         }
 
-        TuRmlDrawCommand drawCmd;
-        drawCmd.geometryHandle = geometry;
-        drawCmd.translation = AZ::Vector2(translation.x, translation.y);
-        drawCmd.texture = texture;
-        drawCmd.transform = m_transform;
-        drawCmd.clipmaskEnabled = m_testClipMask;
-        drawCmd.stencilRef = m_stencilRef;
-        if (m_scissorEnabled)
+        AZStd::lock_guard<AZStd::mutex> lock(m_releaseMutex);
+        for (TuRmlTextureAtlas::Page& page : retiredPages)
+        {
+            PendingRelease release;
+            release.type = PendingRelease::Type::AtlasPage;
+            release.atlasPage = AZStd::move(page);
+            release.frame = m_frameNumber;
+            m_pendingReleases.push_back(AZStd::move(release));
+        }
+    }
+
+    AZ::RPI::ShaderResourceGroup* TuRmlRenderInterface::GetTextureSrg(Rml::TextureHandle handle,
+                                                                      const AZ::Data::Instance<AZ::RPI::Shader>& shader)
+    {
+        AZ::Data::Instance<AZ::RPI::ShaderResourceGroup>* srg = &m_defaultTextureSrg;
+        AZ::Data::Instance<AZ::RPI::Image> image;
+        if (auto* storedTex = m_textures.Get(handle))
         {
-            drawCmd.scissorRegion = m_scissorRegion;
+            if (storedTex->IsInAtlas())
+            {
+                TuRmlTextureAtlas::Page* page = m_textureAtlas.GetPage(storedTex->atlasEntry);
+                srg = &page->textureSrg;
+                image = page->image;
+            }
+            else
+            {
+                srg = &storedTex->textureSrg;
+                image = storedTex->streamingImage ? storedTex->streamingImage : GetPlaceholderImage();
+            }
         }
         else
         {
-            drawCmd.scissorRegion = {};
+            image = AZ::RPI::ImageSystemInterface::Get()->GetSystemImage(AZ::RPI::SystemImage::White);
         }
 
-        if (m_draw_to_clipmask)
+        if (!*srg)
         {
-            drawCmd.drawType = TuRmlDrawCommand::DrawType::Clipmask;
-            drawCmd.clipmask_op = m_clipmaskOperation;
+            *srg = AZ::RPI::ShaderResourceGroup::Create(
+                shader->GetAsset(), shader->GetSupervariantIndex(), AZ::Name("TextureSrg"));
+            if (!*srg)
+            {
+                AZ_Error("TuRmlRenderInterface", false, "Failed to create TextureSrg");
+                return nullptr;
+            }
+
+            if (image)
+            {
+                (*srg)->SetImage(m_textureIndex, image);
+            }
+            (*srg)->Compile();
         }
-        else
+
+        return srg->get();
+    }
+
+    AZ::Vector4 TuRmlRenderInterface::GetTextureUvRect(Rml::TextureHandle handle)
+    {
+        const auto* storedTex = GetStoredTexture(handle);
+        if (!storedTex || !storedTex->IsInAtlas())
         {
-            drawCmd.drawType = TuRmlDrawCommand::DrawType::Normal;
-            drawCmd.clipmask_op = m_clipmaskOperation;
+            return AZ::Vector4(0.0f, 0.0f, 1.0f, 1.0f);
         }
-
-        GetDrawCommands().push_back({drawCmd});
+        return m_textureAtlas.GetUvRect(storedTex->atlasEntry);
     }
 
-    void TuRmlRenderInterface::ReleaseGeometry(Rml::CompiledGeometryHandle geometry)
+    uintptr_t TuRmlRenderInterface::GetTextureBindingKey(Rml::TextureHandle handle)
     {
-        if (!geometry)
+        const auto* storedTex = GetStoredTexture(handle);
+        if (!storedTex || !storedTex->IsInAtlas())
         {
-            return;
+            return static_cast<uintptr_t>(handle);
         }
 
-        auto* storedGeo = GetStoredGeometry(geometry);
-        AZ_Assert(storedGeo->creatorPass != nullptr,
-                  "Trying to release geometry when no pass is present for a Undecided/Transient geo");
-        storedGeo->creatorPass->m_drawCommands.Get().queuedFreeGeos.push_back(geometry);
+        AZStd::lock_guard<AZStd::mutex> lock(m_textureSrgMutex);
+        return m_textureAtlas.GetBindingKey(storedTex->atlasEntry);
     }
 
-    Rml::TextureHandle TuRmlRenderInterface::LoadTexture(Rml::Vector2i& texture_dimensions, const Rml::String& source)
+    const AZ::Data::Instance<AZ::RPI::StreamingImage>& TuRmlRenderInterface::GetPlaceholderImage()
+    {
+        if (!m_placeholderImage)
+        {
+            const uint8_t transparent[4] = { 0, 0, 0, 0 };
+            m_placeholderImage = AZ::RPI::StreamingImage::CreateFromCpuData(
+                *AZ::RPI::ImageSystemInterface::Get()->GetSystemStreamingPool(),
+                AZ::RHI::ImageDimension::Image2D,
+                AZ::RHI::Size(1, 1, 1),
+                AZ::RHI::Format::R8G8B8A8_UNORM,
+                transparent,
+                sizeof(transparent),
+                AZ::Uuid::CreateRandom()
+            );
+            AZ_Error("TuRmlRenderInterface", m_placeholderImage, "Failed to create placeholder texture");
+        }
+        return m_placeholderImage;
+    }
+
+    TuRmlStoredTexture* TuRmlRenderInterface::FindOrLoadFileTexture(const AZStd::string& path)
     {
+        if (auto it = m_fileTextures.find(path); it != m_fileTextures.end())
+        {
+            return it->second;
+        }
+
         AZ::Data::AssetId assetId;
-        AZ::Data::AssetInfo assetInfo;
         AZ::Data::AssetCatalogRequestBus::BroadcastResult(
             assetId,
             &AZ::Data::AssetCatalogRequestBus::Events::GetAssetIdByPath,
-            source.c_str(),
+            path.c_str(),
             azrtti_typeid<AZ::RPI::StreamingImageAsset>(), // Let it auto-detect asset type
             true
         );
 
         if (!assetId.IsValid())
         {
-            AZ_Warning("TuRml", false, "Failed to find texture asset: %s", source.c_str());
-            return 0;
+            AZ_Warning("TuRml", false, "Failed to find texture asset: %s", path.c_str());
+            return nullptr;
         }
 
-        // Load the texture asset
+        // Queued so the render path never waits on disk, a placeholder is bound until it's ready
         auto imageAsset = AZ::Data::AssetManager::Instance().GetAsset<AZ::RPI::StreamingImageAsset>(
             assetId,
-            AZ::Data::AssetLoadBehavior::PreLoad
+            AZ::Data::AssetLoadBehavior::QueueLoad
         );
 
-        imageAsset.BlockUntilLoadComplete();
+        if (imageAsset.IsError())
+        {
+            AZ_Warning("TuRml", false, "Failed to load texture asset: %s", path.c_str());
+            return nullptr;
+        }
+
+        const Rml::TextureHandle handle = m_textures.Emplace();
+        TuRmlStoredTexture* storedTex = m_textures.Get(handle);
+        if (!storedTex)
+        {
+            return nullptr;
+        }
+        storedTex->handle = handle;
+        storedTex->sourcePath = path;
+        storedTex->textureAsset = imageAsset;
+        storedTex->dimensions = AZ::PackedVector2i(1, 1);
+        storedTex->pending = true;
+
+        if (imageAsset.IsReady())
+        {
+            FinishFileTexture(*storedTex);
+        }
+
+        m_fileTextures.emplace(path, storedTex);
+        ++m_textureCreationCount;
+        return storedTex;
+    }
+
+    void TuRmlRenderInterface::FinishFileTexture(TuRmlStoredTexture& texture)
+    {
+        texture.pending = false;
+
+        auto image = AZ::RPI::StreamingImage::FindOrCreate(texture.textureAsset);
+        if (!image)
+        {
+            AZ_Warning("TuRml", false, "Failed to create StreamingImage from asset: %s", texture.sourcePath.c_str());
+            return;
+        }
+
+        const AZ::RHI::ImageDescriptor& imageDesc = texture.textureAsset->GetImageDescriptor();
+        texture.dimensions = AZ::PackedVector2i(
+            static_cast<int>(imageDesc.m_size.m_width), static_cast<int>(imageDesc.m_size.m_height));
+
+        // The srg still binds the placeholder, it gets recreated on next use
+        AZStd::lock_guard<AZStd::mutex> lock(m_textureSrgMutex);
+        texture.streamingImage = image;
+        texture.textureSrg.reset();
+        ++m_textureGeneration;
+    }
+
+    void TuRmlRenderInterface::UpdatePendingTextures()
+    {
+        AZ_PROFILE_FUNCTION(RmlBudget);
+
+        AZStd::vector<AZStd::string> resized;
+        {
+            AZStd::lock_guard<AZStd::mutex> lock(m_fileTextureMutex);
+            for (auto it = m_fileTextures.begin(); it != m_fileTextures.end();)
+            {
+                TuRmlStoredTexture* texture = it->second;
+                if (texture->pending)
+                {
+                    if (texture->textureAsset.IsReady())
+                    {
+                        FinishFileTexture(*texture);
+                        const bool resizedFromPlaceholder =
+                            texture->dimensions.GetX() != 1 || texture->dimensions.GetY() != 1;
+                        if (texture->placeholderDimensions && resizedFromPlaceholder)
+                        {
+                            resized.push_back(texture->sourcePath);
+                        }
+                        texture->placeholderDimensions = false;
+                    }
+                    else if (texture->textureAsset.IsError())
+                    {
+                        // Keeps the placeholder
+                        AZ_Warning("TuRml", false, "Failed to load texture asset: %s", texture->sourcePath.c_str());
+                        texture->pending = false;
+                        texture->placeholderDimensions = false;
+                    }
+                }
+
+                const auto lingerTicks = static_cast<uint32_t>(static_cast<int>(r_rmlTextureCacheLingerTicks));
+                if (texture->refCount == 0 && ++texture->unusedTicks > lingerTicks)
+                {
+                    // Out of the cache now, the image goes once frames in flight are done sampling it
+                    QueueRelease(PendingRelease::Type::Texture, texture->handle);
+                    ++m_textureGeneration;
+                    it = m_fileTextures.erase(it);
+                    continue;
+                }
+                ++it;
+            }
+        }
+
+        // RmlUi cached the placeholder's size, have it load the texture again. This calls back into
+        // ReleaseTexture so it has to happen outside the lock. Each render interface has its own texture cache.
+        AZStd::vector<Rml::RenderInterface*> renderInterfaces = { this };
+        if (!resized.empty())
+        {
+            AZStd::lock_guard<AZStd::mutex> lock(m_contextInterfaceMutex);
+            for (const auto& contextInterface : m_contextInterfaces)
+            {
+                renderInterfaces.push_back(contextInterface.get());
+            }
+        }
+        for (const AZStd::string& path : resized)
+        {
+            for (Rml::RenderInterface* renderInterface : renderInterfaces)
+            {
+                Rml::ReleaseTexture(path.c_str(), renderInterface);
+            }
+            RefreshImageElements(path);
+        }
+    }
+
+    AZStd::string TuRmlRenderInterface::ResolveDocumentPath(Rml::ElementDocument* document, const Rml::String& source)
+    {
+        // Same as RmlUi's texture database, sources are relative to the document
+        const Rml::URL documentUrl(document->GetSourceURL());
+        Rml::String path;
+        Rml::GetSystemInterface()->JoinPath(path, Rml::StringUtilities::Replace(documentUrl.GetPath(), '|', ':'),
+                                            Rml::StringUtilities::Replace(source, '|', ':'));
+        return path.c_str();
+    }
+
+    void TuRmlRenderInterface::RefreshImageElements(const AZStd::string& path)
+    {
+        for (int contextIndex = 0; contextIndex < Rml::GetNumContexts(); ++contextIndex)
+        {
+            Rml::Context* context = Rml::GetContext(contextIndex);
+            for (int documentIndex = 0; context && documentIndex < context->GetNumDocuments(); ++documentIndex)
+            {
+                Rml::ElementDocument* document = context->GetDocument(documentIndex);
+                Rml::ElementList images;
+                document->GetElementsByTagName(images, "img");
+                for (Rml::Element* image : images)
+                {
+                    const Rml::String source = image->GetAttribute<Rml::String>("src", "");
+                    if (!source.empty() && ResolveDocumentPath(document, source) == path)
+                    {
+                        // Resetting the source dirties the image's texture and layout
+                        image->SetAttribute("src", source);
+                    }
+                }
+            }
+        }
+    }
+
+    void TuRmlRenderInterface::PreloadTextures(const AZStd::vector<AZStd::string>& texturePaths)
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_fileTextureMutex);
+        for (const AZStd::string& path : texturePaths)
+        {
+            TuRmlStoredTexture* texture = FindOrLoadFileTexture(path);
+            if (texture && !texture->preloaded)
+            {
+                texture->preloaded = true;
+                ++texture->refCount;
+            }
+        }
+    }
+
+    void TuRmlRenderInterface::PreloadDocumentTextures(Rml::ElementDocument* document)
+    {
+        if (!document)
+        {
+            return;
+        }
+
+        AZStd::vector<AZStd::string> texturePaths;
+        Rml::ElementList images;
+        document->GetElementsByTagName(images, "img");
+        for (Rml::Element* image : images)
+        {
+            const Rml::String source = image->GetAttribute<Rml::String>("src", "");
+            if (!source.empty())
+            {
+                texturePaths.push_back(ResolveDocumentPath(document, source));
+            }
+        }
+        PreloadTextures(texturePaths);
+    }
+
+    void TuRmlRenderInterface::ClearPreloadedTextures()
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_fileTextureMutex);
+        for (auto& [path, texture] : m_fileTextures)
+        {
+            if (texture->preloaded)
+            {
+                texture->preloaded = false;
+                if (--texture->refCount == 0)
+                {
+                    texture->unusedTicks = 0;
+                }
+            }
+        }
+    }
 
-        if (!imageAsset.IsReady())
+    Rml::CompiledGeometryHandle TuRmlRenderInterface::CompileGeometry(Rml::Span<const Rml::Vertex> vertices,
+                                                                      Rml::Span<const int> indices,
+                                                                      TuRmlChildPass* recordingPass)
+    {
+        if (vertices.empty() || indices.empty())
         {
-            AZ_Warning("TuRml", false, "Failed to load texture asset: %s", source.c_str());
             return 0;
         }
 
-        // Get texture dimensions
-        const AZ::RHI::ImageDescriptor& imageDesc = imageAsset->GetImageDescriptor();
-        texture_dimensions.x = static_cast<int>(imageDesc.m_size.m_width);
-        texture_dimensions.y = static_cast<int>(imageDesc.m_size.m_height);
+        // Everything below stores the feathered geometry, deduplication compares against that as well
+        const size_t coreIndexCount = indices.size();
+        AZStd::vector<Rml::Vertex> featheredVertices;
+        AZStd::vector<int> featheredIndices;
+        if (r_rmlAnalyticAA && FeatherEdges(vertices, indices, featheredVertices, featheredIndices))
+        {
+            vertices = Rml::Span<const Rml::Vertex>(featheredVertices.data(), featheredVertices.size());
+            indices = Rml::Span<const int>(featheredIndices.data(), featheredIndices.size());
+        }
 
-        TuRmlStoredTexture* storedTex = aznew TuRmlStoredTexture();
-        storedTex->textureAsset = imageAsset;
+        AZ::u64 contentHash = 0;
+        if (r_rmlGeometryDedup)
+        {
+            contentHash = HashBytes(indices.data(), indices.size() * sizeof(int),
+                HashBytes(vertices.data(), vertices.size() * sizeof(Rml::Vertex), vertices.size()));
+            if (Rml::CompiledGeometryHandle shared = FindDuplicateGeometry(contentHash, vertices, indices))
+            {
+                return shared;
+            }
+        }
 
-        storedTex->streamingImage = AZ::RPI::StreamingImage::FindOrCreate(imageAsset);
+        const Rml::CompiledGeometryHandle handle = m_geometries.Emplace();
+        auto* storedGeo = m_geometries.Get(handle);
+        if (!storedGeo)
+        {
+            return 0;
+        }
+        storedGeo->handle = handle;
+        storedGeo->contentHash = contentHash;
+        storedGeo->vertexCount = vertices.size();
+        storedGeo->indexCount = indices.size();
+        storedGeo->coreIndexCount = coreIndexCount;
+        storedGeo->serial = ++m_geometrySerial;
+        storedGeo->format = TuRmlVertexFormat::Choose(vertices.data(), vertices.size());
+
+        // Two vertices per lane pair, folded together at the end
+        using AZ::Simd::Vec4;
+        const Rml::Vertex& firstVertex = vertices[0];
+        Vec4::FloatType boundsMin = Vec4::LoadImmediate(
+            firstVertex.position.x, firstVertex.position.y, firstVertex.position.x, firstVertex.position.y);
+        Vec4::FloatType boundsMax = boundsMin;
+        size_t vertexIndex = 1;
+        for (; vertexIndex + 1 < vertices.size(); vertexIndex += 2)
+        {
+            const Rml::Vector2f& p0 = vertices[vertexIndex].position;
+            const Rml::Vector2f& p1 = vertices[vertexIndex + 1].position;
+            const Vec4::FloatType positions = Vec4::LoadImmediate(p0.x, p0.y, p1.x, p1.y);
+            boundsMin = Vec4::Min(boundsMin, positions);
+            boundsMax = Vec4::Max(boundsMax, positions);
+        }
+        if (vertexIndex < vertices.size())
+        {
+            const Rml::Vector2f& p0 = vertices[vertexIndex].position;
+            const Vec4::FloatType positions = Vec4::LoadImmediate(p0.x, p0.y, p0.x, p0.y);
+            boundsMin = Vec4::Min(boundsMin, positions);
+            boundsMax = Vec4::Max(boundsMax, positions);
+        }
 
-        if (!storedTex->streamingImage)
+        float lanesMin[4];
+        float lanesMax[4];
+        Vec4::StoreUnaligned(lanesMin, boundsMin);
+        Vec4::StoreUnaligned(lanesMax, boundsMax);
+        storedGeo->boundsMin =
+            Rml::Vector2f(AZStd::min(lanesMin[0], lanesMin[2]), AZStd::min(lanesMin[1], lanesMin[3]));
+        storedGeo->boundsMax =
+            Rml::Vector2f(AZStd::max(lanesMax[0], lanesMax[2]), AZStd::max(lanesMax[1], lanesMax[3]));
+        storedGeo->axisAlignedRect = IsAxisAlignedRect(vertices, indices, storedGeo->boundsMin, storedGeo->boundsMax);
+
+        // Whether it's transient is only known at End(), which copies it into the ring or the heaps from here
+        storedGeo->vertices = m_vertexPool.Acquire(vertices.size());
+        storedGeo->indices = m_indexPool.Acquire(indices.size());
+        AZStd::copy(vertices.begin(), vertices.end(), storedGeo->vertices.begin());
+        AZStd::copy(indices.begin(), indices.end(), storedGeo->indices.begin());
+
+        storedGeo->storageType = TuRmlStoredGeometry::StorageType::Undecided;
+        storedGeo->creatorPass = recordingPass;
+        storedGeo->createdThisFrame = recordingPass != nullptr;
+        return handle;
+    }
+
+    void TuRmlRenderInterface::ReleaseGeometry(Rml::CompiledGeometryHandle geometry, TuRmlChildPass* recordingPass)
+    {
+        if (!geometry)
+        {
+            return;
+        }
+
+        auto* storedGeo = GetStoredGeometry(geometry);
+        if (!storedGeo)
+        {
+            AZ_Error("TuRmlRenderInterface", false, "Releasing geometry with stale handle 0x%llx",
+                     static_cast<unsigned long long>(geometry));
+            return;
+        }
+        bool shared = false;
+        {
+            AZStd::lock_guard<AZStd::mutex> lock(m_geometryMutex);
+            if (storedGeo->refCount > 1)
+            {
+                --storedGeo->refCount;
+                return;
+            }
+            // Queued for destruction, nothing may pick it up from the cache anymore
+            RemoveFromDedupCache(*storedGeo);
+            shared = storedGeo->shared;
+        }
+
+        // Its draw list can't be submitted again, End() also tells transient geometry apart by this.
+        // Shared geometry may also be in the draw lists of other contexts, which may be clean and reuse them, and its
+        // creator pass may be gone or recording on another thread. It bumps the geometry generation instead, which
+        // keeps every pass from reusing a draw list recorded before. Either way only the release queue destroys it.
+        TuRmlChildPass* pass = recordingPass;
+        if (!pass && !shared)
+        {
+            pass = storedGeo->creatorPass;
+        }
+        if (pass)
+        {
+            pass->m_drawCommands.Get().queuedFreeGeos.push_back(geometry);
+        }
+        if (shared)
+        {
+            ++m_geometryGeneration;
+        }
+        QueueRelease(PendingRelease::Type::Geometry, geometry);
+    }
+
+#pragma region Rml::RenderInterface
+    Rml::CompiledGeometryHandle TuRmlRenderInterface::CompileGeometry(Rml::Span<const Rml::Vertex> vertices,
+                                                                      Rml::Span<const int> indices)
+    {
+        return m_defaultContextInterface->CompileGeometry(vertices, indices);
+    }
+
+    void TuRmlRenderInterface::RenderGeometry(Rml::CompiledGeometryHandle geometry, Rml::Vector2f translation,
+                                              Rml::TextureHandle texture)
+    {
+        m_defaultContextInterface->RenderGeometry(geometry, translation, texture);
+    }
+
+    void TuRmlRenderInterface::ReleaseGeometry(Rml::CompiledGeometryHandle geometry)
+    {
+        m_defaultContextInterface->ReleaseGeometry(geometry);
+    }
+
+    Rml::TextureHandle TuRmlRenderInterface::LoadTexture(Rml::Vector2i& texture_dimensions, const Rml::String& source)
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_fileTextureMutex);
+        TuRmlStoredTexture* storedTex = FindOrLoadFileTexture(source.c_str());
+        if (!storedTex)
         {
-            AZ_Warning("TuRml", false, "Failed to create StreamingImage from asset: %s", source.c_str());
-            delete storedTex;
             return 0;
         }
 
-        ++m_textureCreationCount;
-        return reinterpret_cast<Rml::TextureHandle>(storedTex);
+        ++storedTex->refCount;
+        storedTex->unusedTicks = 0;
+        if (storedTex->pending)
+        {
+            storedTex->placeholderDimensions = true;
+        }
+
+        texture_dimensions.x = storedTex->dimensions.GetX();
+        texture_dimensions.y = storedTex->dimensions.GetY();
+        return storedTex->handle;
     }
 
     Rml::TextureHandle TuRmlRenderInterface::GenerateTexture(Rml::Span<const Rml::byte> source,
@@ -295,9 +891,29 @@ namespace TuRml
             return 0;
         }
 
-        TuRmlStoredTexture* storedTex = aznew TuRmlStoredTexture();
+        const Rml::TextureHandle handle = m_textures.Emplace();
+        TuRmlStoredTexture* storedTex = m_textures.Get(handle);
+        if (!storedTex)
+        {
+            return 0;
+        }
+        storedTex->handle = handle;
         storedTex->dimensions = AZ::PackedVector2i(source_dimensions.x, source_dimensions.y);
 
+        const int atlasMaxSize = r_rmlTextureAtlasMaxSize;
+        if (r_rmlTextureAtlas && source_dimensions.x <= atlasMaxSize && source_dimensions.y <= atlasMaxSize)
+        {
+            AZStd::lock_guard<AZStd::mutex> lock(m_textureSrgMutex);
+            storedTex->atlasEntry = m_textureAtlas.Add(source.data(), aznumeric_cast<uint32_t>(source_dimensions.x),
+                                                       aznumeric_cast<uint32_t>(source_dimensions.y));
+            if (storedTex->IsInAtlas())
+            {
+                // The page image is only replaced by the next ResolveTextures
+                ++m_textureCreationCount;
+                return handle;
+            }
+        }
+
         AZ::RHI::Size imageSize;
         imageSize.m_width = aznumeric_cast<uint32_t>(source_dimensions.x);
         imageSize.m_height = aznumeric_cast<uint32_t>(source_dimensions.y);
@@ -307,7 +923,7 @@ namespace TuRml
 
         const uint32_t pixelDataSize = source_dimensions.x * source_dimensions.y * 4;
 
-        AZStd::string textureName = AZStd::string::format("TuRml Texture #%p", storedTex);
+        AZStd::string textureName = AZStd::string::format("TuRml Texture #%llx", static_cast<unsigned long long>(handle));
         AZ::Uuid textureId = AZ::Uuid::CreateRandom();
 
         storedTex->streamingImage = AZ::RPI::StreamingImage::CreateFromCpuData(
@@ -322,9 +938,9 @@ namespace TuRml
 
         if (!storedTex->streamingImage)
         {
-            AZ_Error("TuRmlRenderInterface", false, "Failed to create texture handle %p (%dx%d)", storedTex,
-                     source_dimensions.x, source_dimensions.y);
-            delete storedTex;
+            AZ_Error("TuRmlRenderInterface", false, "Failed to create texture handle 0x%llx (%dx%d)",
+                     static_cast<unsigned long long>(handle), source_dimensions.x, source_dimensions.y);
+            m_textures.Remove(handle);
             return 0;
         }
 
@@ -333,10 +949,10 @@ namespace TuRml
             storedTex->streamingImage->GetRHIImage()->SetName(AZ::Name(textureName));
         }
 
-        AZ_Info("TuRmlRenderInterface", "Created texture handle %p (%dx%d, %u bytes)", storedTex, source_dimensions.x,
-                source_dimensions.y, pixelDataSize);
+        AZ_Info("TuRmlRenderInterface", "Created texture handle 0x%llx (%dx%d, %u bytes)",
+                static_cast<unsigned long long>(handle), source_dimensions.x, source_dimensions.y, pixelDataSize);
         ++m_textureCreationCount;
-        return reinterpret_cast<Rml::TextureHandle>(storedTex);
+        return handle;
     }
 
     void TuRmlRenderInterface::ReleaseTexture(Rml::TextureHandle textureId)
@@ -346,278 +962,504 @@ namespace TuRml
             return;
         }
 
-        auto texture = reinterpret_cast<TuRmlStoredTexture*>(textureId);
+        auto* texture = m_textures.Get(textureId);
+        if (!texture)
+        {
+            AZ_Error("TuRmlRenderInterface", false, "Releasing texture with stale handle 0x%llx",
+                     static_cast<unsigned long long>(textureId));
+            return;
+        }
+        if (!texture->sourcePath.empty())
+        {
+            // Shared file texture, UpdatePendingTextures evicts it once it has been unused for a while
+            AZStd::lock_guard<AZStd::mutex> lock(m_fileTextureMutex);
+            AZ_Assert(texture->refCount > 0, "File texture %s released more often than loaded", texture->sourcePath.c_str());
+            if (--texture->refCount == 0)
+            {
+                texture->unusedTicks = 0;
+            }
+            return;
+        }
+
+        // Draw lists recorded with it can't be submitted again, frames in flight may still sample it
+        ++m_textureGeneration;
+        QueueRelease(PendingRelease::Type::Texture, textureId);
+        AZ_Info("TuRmlRenderInterface", "Released texture handle 0x%llx", static_cast<unsigned long long>(textureId));
+    }
+
+    void TuRmlRenderInterface::DestroyTexture(Rml::TextureHandle textureId)
+    {
+        auto* texture = m_textures.Get(textureId);
+        if (!texture)
+        {
+            return;
+        }
+
+        {
+            AZStd::lock_guard<AZStd::mutex> lock(m_textureSrgMutex);
+            if (texture->IsInAtlas())
+            {
+                m_textureAtlas.Remove(texture->atlasEntry);
+                QueueAtlasPageReleases();
+            }
+            texture->textureSrg.reset();
+        }
         texture->streamingImage.reset();
         texture->textureAsset.Reset();
 
         --m_textureCreationCount;
-        AZ_Info("TuRmlRenderInterface", "Released texture handle %p (index %zu)", texture, index);
-        delete texture;
+        m_textures.Remove(textureId);
     }
 
     void TuRmlRenderInterface::EnableScissorRegion(bool enable)
     {
-        m_scissorEnabled = enable;
+        m_defaultContextInterface->EnableScissorRegion(enable);
     }
 
     void TuRmlRenderInterface::SetScissorRegion(Rml::Rectanglei region)
     {
-        m_scissorRegion = region;
+        m_defaultContextInterface->SetScissorRegion(region);
     }
 
     void TuRmlRenderInterface::SetTransform(const Rml::Matrix4f* transform)
     {
-        if (transform)
-        {
-            m_transform = m_contextTransform * AZ::Matrix4x4::CreateFromColumnMajorFloat16(
-                reinterpret_cast<const float*>(transform));
-        }
-        else
-        {
-            m_transform = m_contextTransform * AZ::Matrix4x4::CreateIdentity();
-        }
+        m_defaultContextInterface->SetTransform(transform);
     }
 
     void TuRmlRenderInterface::EnableClipMask(bool enable)
     {
-        m_testClipMask = enable;
+        m_defaultContextInterface->EnableClipMask(enable);
     }
 
     void TuRmlRenderInterface::RenderToClipMask(Rml::ClipMaskOperation operation, Rml::CompiledGeometryHandle geometry,
                                                 Rml::Vector2f translation)
     {
-        m_draw_to_clipmask = true;
+        m_defaultContextInterface->RenderToClipMask(operation, geometry, translation);
+    }
+#pragma endregion
 
-        auto& drawCmds = GetDrawCommands();
 
-        const bool clearClipmask = (operation == Rml::ClipMaskOperation::Set || operation ==
-            Rml::ClipMaskOperation::SetInverse);
-        if (clearClipmask)
+    bool TuRmlRenderInterface::IsBatchable(const TuRmlDrawCommand& cmd)
+    {
+        if (cmd.drawType == TuRmlDrawCommand::DrawType::ClearClipmask)
         {
-            //Submit clear cmd
-            TuRmlDrawCommand drawCmd;
-            drawCmd.drawType = TuRmlDrawCommand::DrawType::ClearClipmask;
-            drawCmds.push_back({drawCmd});
+            return false;
         }
 
-        auto oldStencilRef = m_stencilRef;
+        // Needs the CPU copy to bake the translation into the vertices
+        const auto* geo = GetStoredGeometry(cmd.geometryHandle);
+        if (!geo || geo->vertices.empty() || geo->indices.empty() ||
+            geo->vertexCount > static_cast<size_t>(static_cast<int>(r_rmlBatchMaxVertices)))
+        {
+            return false;
+        }
 
-        m_stencilRef = 1;
+        // Batches bake all indices, a clip mask must not write its fringe into the stencil
+        return cmd.drawType != TuRmlDrawCommand::DrawType::Clipmask || geo->coreIndexCount == geo->indexCount;
+    }
 
-        switch (operation)
+    bool TuRmlRenderInterface::UploadPersistentGeometry(TuRmlStoredGeometry& geo)
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_geometryMutex);
+        if (geo.uploaded || !geo.HasData())
         {
-        case Rml::ClipMaskOperation::Set:
-            oldStencilRef = 1;
-            break;
-        case Rml::ClipMaskOperation::SetInverse:
-            oldStencilRef = 0;
-            break;
-        case Rml::ClipMaskOperation::Intersect:
-            oldStencilRef += 1;
-            break;
+            return geo.uploaded;
         }
-        m_clipmaskOperation = operation;
 
-        RenderGeometry(geometry, translation, {});
+        const TuRmlVertexFormat& format = geo.format;
+        const size_t vertexBytes = geo.vertexCount * format.GetVertexStride();
+        const size_t indexBytes = geo.indexCount * format.GetIndexSize();
 
-        m_stencilRef = oldStencilRef;
-        m_draw_to_clipmask = false;
-    }
+        m_uploadScratch.resize(vertexBytes + indexBytes);
+        format.WriteVertices(geo.vertices.data(), geo.vertexCount, m_uploadScratch.data());
+        format.WriteIndices(geo.indices.data(), geo.indexCount, m_uploadScratch.data() + vertexBytes);
+        const uint8_t* vertexData = m_uploadScratch.data();
+        const uint8_t* indexData = m_uploadScratch.data() + vertexBytes;
 
-    AZStd::vector<TuRmlChildPassDrawCommand>& TuRmlRenderInterface::GetDrawCommands() const
-    {
-        return m_pass->m_drawCommands.Get().drawCmds;
-    }
+        geo.vertexAllocation = m_vertexHeap.Allocate(vertexBytes);
+        geo.indexAllocation = m_indexHeap.Allocate(indexBytes);
 
-#pragma endregion
+        if (!geo.vertexAllocation.IsValid() || !geo.indexAllocation.IsValid())
+        {
+            m_vertexHeap.Free(geo.vertexAllocation);
+            m_indexHeap.Free(geo.indexAllocation);
+            geo.vertexAllocation = {};
+            geo.indexAllocation = {};
+            return false;
+        }
+
+        m_vertexHeap.UpdateData(geo.vertexAllocation, vertexData, vertexBytes);
+        m_indexHeap.UpdateData(geo.indexAllocation, indexData, indexBytes);
+        CountUpload(format, geo.vertexCount, geo.indexCount);
+
+        geo.vertexBufferView = AZ::RHI::StreamBufferView(
+            *m_vertexHeap.GetBuffer(geo.vertexAllocation)->GetRHIBuffer(),
+            geo.vertexAllocation.offset,
+            static_cast<uint32_t>(vertexBytes),
+            static_cast<uint32_t>(format.GetVertexStride())
+        );
+
+        geo.indexBufferView = AZ::RHI::IndexBufferView(
+            *m_indexHeap.GetBuffer(geo.indexAllocation)->GetRHIBuffer(),
+            geo.indexAllocation.offset,
+            static_cast<uint32_t>(indexBytes),
+            format.GetIndexFormat()
+        );
+
+        geo.uploaded = true;
+
+        // Small geometry keeps its CPU copy so later frames can batch it, cached geometry so compiles can compare
+        const bool keepCpuCopy = geo.inDedupCache || (r_rmlBatching &&
+            geo.vertexCount <= static_cast<size_t>(static_cast<int>(r_rmlBatchMaxVertices)));
+        if (!keepCpuCopy)
+        {
+            // Back to the pools right away, clear() would hold on to the capacity until the geometry is released
+            m_vertexPool.Release(geo.vertices);
+            m_indexPool.Release(geo.indices);
+        }
+        return true;
+    }
 
-    ReusableBuffer* TuRmlRenderInterface::RequestBuffer(size_t capacity, size_t elementSize)
+    bool TuRmlRenderInterface::IsAxisAlignedRect(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices,
+                                                 Rml::Vector2f boundsMin, Rml::Vector2f boundsMax)
     {
-        const auto elementCount = capacity / elementSize;
-        constexpr size_t MinElementCount = 32;
-        if (elementCount < MinElementCount)
+        if (vertices.size() != 4 || indices.size() != 6 || boundsMax.x <= boundsMin.x || boundsMax.y <= boundsMin.y)
         {
-            capacity = elementSize * MinElementCount;
+            return false;
         }
 
-        auto it = std::lower_bound(
-            m_buffers.begin(), m_buffers.end(),
-            capacity,
-            [](const AZStd::unique_ptr<ReusableBuffer>& lhs, size_t capacity)
+        // Every vertex on a different corner, bit 0 for the right edge and bit 1 for the bottom one
+        int cornerOf[4];
+        int corners = 0;
+        for (size_t i = 0; i < vertices.size(); ++i)
+        {
+            const Rml::Vector2f& p = vertices[i].position;
+            if ((p.x != boundsMin.x && p.x != boundsMax.x) || (p.y != boundsMin.y && p.y != boundsMax.y))
             {
-                return lhs->buffer->GetBufferSize() < capacity;
-            });
+                return false;
+            }
+            cornerOf[i] = (p.x == boundsMax.x ? 1 : 0) | (p.y == boundsMax.y ? 2 : 0);
+            corners |= 1 << cornerOf[i];
+        }
+        if (corners != 0xF)
+        {
+            return false;
+        }
 
-        for (auto tmp_it = it; tmp_it != m_buffers.end(); ++tmp_it)
+        // Each triangle leaves out one corner, they only split the rectangle along a diagonal when those are opposite
+        int leftOut[2];
+        for (size_t triangle = 0; triangle < 2; ++triangle)
         {
-            const auto& buffer = *tmp_it;
-            if (buffer->buffer->GetBufferSize() >= capacity &&
-                !buffer->inUse &&
-                buffer->elementSize == elementSize)
+            int triangleCorners = 0;
+            for (size_t i = triangle * 3; i < triangle * 3 + 3; ++i)
+            {
+                if (indices[i] < 0 || indices[i] > 3)
+                {
+                    return false;
+                }
+                triangleCorners |= 1 << cornerOf[indices[i]];
+            }
+            const int missing = 0xF & ~triangleCorners;
+            if (missing == 0 || (missing & (missing - 1)) != 0)
             {
-                return buffer.get();
+                return false;
             }
+            leftOut[triangle] = missing == 1 ? 0 : missing == 2 ? 1 : missing == 4 ? 2 : 3;
         }
-
-        auto buffer = AZStd::make_unique<ReusableBuffer>();
-        AZ::RPI::CommonBufferDescriptor desc;
-        desc.m_poolType = AZ::RPI::CommonBufferPoolType::DynamicInputAssembly;
-        desc.m_bufferName = "Rml Reusable Buffer #" + AZStd::to_string(m_buffers.size());
-        desc.m_byteCount = capacity;
-        desc.m_elementSize = elementSize;
-        desc.m_bufferData = nullptr;
-
-        buffer->buffer = AZ::RPI::BufferSystemInterface::Get()->CreateBufferFromCommonPool(desc);
-        buffer->inUse = false;
-        buffer->elementSize = elementSize;
-        auto inserted_it = m_buffers.insert(it, AZStd::move(buffer));
-        return inserted_it->get();
+        return (leftOut[0] ^ leftOut[1]) == 3;
     }
 
-    void TuRmlRenderInterface::AllocateGPUBuffers()
+    bool TuRmlRenderInterface::FeatherEdges(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices,
+                                            AZStd::vector<Rml::Vertex>& featheredVertices,
+                                            AZStd::vector<int>& featheredIndices)
     {
         AZ_PROFILE_FUNCTION(RmlBudget);
-        auto& frameInfo = m_pass->m_drawCommands.Get();
-        auto& drawCmds = frameInfo.drawCmds;
+        const auto positionKey = [](const Rml::Vector2f& p)
+        {
+            AZ::u32 x;
+            AZ::u32 y;
+            memcpy(&x, &p.x, sizeof(x));
+            memcpy(&y, &p.y, sizeof(y));
+            return (static_cast<AZ::u64>(x) << 32) | y;
+        };
+
+        // Triangle edges keyed by their end positions, so edges of triangles not sharing vertices still match up
+        struct Edge
+        {
+            AZ::u64 lowKey = 0;
+            AZ::u64 highKey = 0;
+            int from = 0;
+            int to = 0;
+            int opposite = 0;
+        };
+        AZStd::vector<Edge> edges;
+        const int vertexCount = static_cast<int>(vertices.size());
+        for (size_t triangle = 0; triangle + 2 < indices.size(); triangle += 3)
+        {
+            const int* corners = &indices[triangle];
+            const auto outOfRange = [vertexCount](int index)
+            {
+                return index < 0 || index >= vertexCount;
+            };
+            if (AZStd::any_of(corners, corners + 3, outOfRange))
+            {
+                return false;
+            }
 
-        // Calculate total transient geometry size
-        size_t totalTransientVertices = 0;
-        size_t totalTransientIndices = 0;
+            // Degenerate triangles don't cover anything, their edges would read as outline
+            const Rml::Vector2f& p0 = vertices[corners[0]].position;
+            const Rml::Vector2f& p1 = vertices[corners[1]].position;
+            const Rml::Vector2f& p2 = vertices[corners[2]].position;
+            if (AZ::GetAbs((p1.x - p0.x) * (p2.y - p0.y) - (p2.x - p0.x) * (p1.y - p0.y)) < 1e-6f)
+            {
+                continue;
+            }
 
-        for (const auto& cmd : drawCmds)
-        {
-            auto* geo = TuRmlRenderInterface::GetStoredGeometry(cmd.drawCommand.geometryHandle);
-            if (geo && geo->storageType == TuRmlStoredGeometry::StorageType::Transient)
+            for (int edge = 0; edge < 3; ++edge)
             {
-                totalTransientVertices += geo->vertices.size();
-                totalTransientIndices += geo->indices.size();
+                const int from = corners[edge];
+                const int to = corners[(edge + 1) % 3];
+                const Rml::Vector2f& a = vertices[from].position;
+                const Rml::Vector2f& b = vertices[to].position;
+                // RmlUi snaps axis aligned edges to pixels, only sloped and curved ones need feathering
+                if (a.x == b.x || a.y == b.y)
+                {
+                    continue;
+                }
+                const AZ::u64 fromKey = positionKey(a);
+                const AZ::u64 toKey = positionKey(b);
+                edges.push_back({ AZStd::min(fromKey, toKey), AZStd::max(fromKey, toKey), from, to,
+                                  corners[(edge + 2) % 3] });
             }
         }
-
-        if (totalTransientVertices > 0 && totalTransientIndices > 0)
+        if (edges.empty())
         {
-           frameInfo.EnsureTransientBufferCapacity(totalTransientVertices, totalTransientIndices);
+            return false;
         }
 
-        // Allocate GPU buffers and upload data
-        size_t transientVertexOffset = 0;
-        size_t transientIndexOffset = 0;
-        AZStd::vector<Rml::Vertex> transientVertexBuffer(totalTransientVertices);
-        AZStd::vector<int> transientIndexBuffer(totalTransientIndices);
+        AZStd::sort(edges.begin(), edges.end(),
+            [](const Edge& lhs, const Edge& rhs)
+            {
+                return lhs.lowKey != rhs.lowKey ? lhs.lowKey < rhs.lowKey : lhs.highKey < rhs.highKey;
+            });
 
-        for (const auto& cmd : drawCmds)
+        // Edges only one triangle has are on the outline, their normals point away from that triangle
+        AZStd::vector<Edge> outline;
+        AZStd::vector<Rml::Vector2f> outlineNormals;
+        AZStd::unordered_map<AZ::u64, Rml::Vector2f> vertexNormals;
+        for (size_t runStart = 0; runStart < edges.size();)
         {
-            auto* geo = GetStoredGeometry(cmd.drawCommand.geometryHandle);
-            if (!geo || geo->vertices.empty() || geo->indices.empty())
+            size_t runEnd = runStart + 1;
+            while (runEnd < edges.size() && edges[runEnd].lowKey == edges[runStart].lowKey &&
+                   edges[runEnd].highKey == edges[runStart].highKey)
             {
-                continue;
+                ++runEnd;
             }
 
-            if (geo->storageType == TuRmlStoredGeometry::StorageType::Persistent)
+            if (runEnd - runStart == 1)
             {
-                const size_t vertexBytes = geo->vertices.size() * sizeof(Rml::Vertex);
-                const size_t indexBytes = geo->indices.size() * sizeof(int);
-
-                geo->vertexBuffer = RequestBuffer(vertexBytes, sizeof(Rml::Vertex));
-                geo->indexBuffer = RequestBuffer(indexBytes, sizeof(int));
-
-                if (geo->vertexBuffer && geo->indexBuffer)
+                const Edge& edge = edges[runStart];
+                const Rml::Vector2f& a = vertices[edge.from].position;
+                const Rml::Vector2f& b = vertices[edge.to].position;
+                Rml::Vector2f normal = Rml::Vector2f(b.y - a.y, a.x - b.x).Normalise();
+                if (normal.DotProduct(vertices[edge.opposite].position - a) > 0.0f)
                 {
-                    geo->vertexBuffer->buffer->UpdateData(geo->vertices.data(), vertexBytes);
-                    geo->indexBuffer->buffer->UpdateData(geo->indices.data(), indexBytes);
-
-                    geo->vertexBufferView = AZ::RHI::StreamBufferView(
-                        *geo->vertexBuffer->buffer->GetRHIBuffer(),
-                        0,
-                        vertexBytes,
-                        sizeof(Rml::Vertex)
-                    );
-
-                    geo->indexBufferView = AZ::RHI::IndexBufferView(
-                        *geo->indexBuffer->buffer->GetRHIBuffer(),
-                        0,
-                        indexBytes,
-                        AZ::RHI::IndexFormat::Uint32
-                    );
-
-                    geo->vertexBuffer->inUse = true;
-                    geo->indexBuffer->inUse = true;
-
-                    geo->vertices.clear();
-                    geo->indices.clear();
+                    normal = -normal;
                 }
+                outline.push_back(edge);
+                outlineNormals.push_back(normal);
+                vertexNormals.emplace(positionKey(a), Rml::Vector2f(0.0f, 0.0f)).first->second += normal;
+                vertexNormals.emplace(positionKey(b), Rml::Vector2f(0.0f, 0.0f)).first->second += normal;
             }
-            else if (geo->storageType == TuRmlStoredGeometry::StorageType::Transient)
-            {
-                geo->vertexOffsetInShared = transientVertexOffset;
-                geo->indexOffsetInShared = transientIndexOffset;
+            runStart = runEnd;
+        }
+        if (outline.empty())
+        {
+            return false;
+        }
 
-                AZStd::copy(
-                    geo->vertices.begin(),
-                    geo->vertices.end(),
-                    transientVertexBuffer.begin() + transientVertexOffset
-                );
+        featheredVertices.assign(vertices.begin(), vertices.end());
+        featheredIndices.assign(indices.begin(), indices.end());
+        featheredIndices.reserve(indices.size() + outline.size() * 6);
 
-                AZStd::copy(
-                    geo->indices.begin(),
-                    geo->indices.end(),
-                    transientIndexBuffer.begin() + transientIndexOffset
-                    );
+        // One outer vertex per outline vertex, pushed out along the averaged normal of the edges meeting there
+        AZStd::unordered_map<int, int> outerVertices;
+        const auto getOuterVertex = [&](int inner, const Rml::Vector2f& edgeNormal)
+        {
+            auto [it, inserted] = outerVertices.emplace(inner, 0);
+            if (inserted)
+            {
+                Rml::Vertex outer = vertices[inner];
+                Rml::Vector2f normal = vertexNormals[positionKey(outer.position)];
+                // The edges of a spike cancel out
+                const float length = normal.Magnitude();
+                normal = length > 1e-3f ? normal / length : edgeNormal;
+                outer.position += normal * FeatherWidth;
+                // Coverage fades to zero across the fringe, premultiplied colors scale in all channels with it
+                outer.colour = Rml::ColourbPremultiplied(0, 0, 0, 0);
+                it->second = static_cast<int>(featheredVertices.size());
+                featheredVertices.push_back(outer);
+            }
+            return it->second;
+        };
+        for (size_t i = 0; i < outline.size(); ++i)
+        {
+            const Edge& edge = outline[i];
+            const int outerFrom = getOuterVertex(edge.from, outlineNormals[i]);
+            const int outerTo = getOuterVertex(edge.to, outlineNormals[i]);
+            featheredIndices.insert(featheredIndices.end(),
+                                    { edge.from, edge.to, outerTo, edge.from, outerTo, outerFrom });
+        }
+        return true;
+    }
 
-                transientVertexOffset += geo->vertices.size();
-                transientIndexOffset += geo->indices.size();
+    Rml::CompiledGeometryHandle TuRmlRenderInterface::FindDuplicateGeometry(
+        AZ::u64 contentHash, Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices)
+    {
+        AZStd::lock_guard<AZStd::mutex> lock(m_geometryMutex);
+        auto [begin, end] = m_dedupCache.equal_range(contentHash);
+        for (auto it = begin; it != end; ++it)
+        {
+            auto* geo = GetStoredGeometry(it->second);
+            if (geo->vertices.size() == vertices.size() && geo->indices.size() == indices.size() &&
+                memcmp(geo->vertices.data(), vertices.data(), vertices.size() * sizeof(Rml::Vertex)) == 0 &&
+                memcmp(geo->indices.data(), indices.data(), indices.size() * sizeof(int)) == 0)
+            {
+                ++geo->refCount;
+                geo->shared = true;
+                ++m_dedupHits;
+                m_dedupBytesSaved += vertices.size() * sizeof(Rml::Vertex) + indices.size() * sizeof(int);
+                return it->second;
+            }
+        }
 
-                geo->vertexBufferView = AZ::RHI::StreamBufferView(
-                    *frameInfo.m_sharedVertexBuffer->GetRHIBuffer(),
-                    geo->vertexOffsetInShared * sizeof(Rml::Vertex),
-                    geo->vertices.size() * sizeof(Rml::Vertex),
-                    sizeof(Rml::Vertex)
-                );
+        ++m_dedupMisses;
+        return 0;
+    }
 
-                geo->indexBufferView = AZ::RHI::IndexBufferView(
-                    *frameInfo.m_sharedIndexBuffer->GetRHIBuffer(),
-                    geo->indexOffsetInShared * sizeof(int),
-                    geo->indices.size() * sizeof(int),
-                    AZ::RHI::IndexFormat::Uint32
-                );
+    void TuRmlRenderInterface::AddToDedupCache(TuRmlStoredGeometry& geo)
+    {
+        // A zero hash was compiled while deduplication was off
+        if (!r_rmlGeometryDedup || geo.contentHash == 0 || geo.vertices.empty())
+        {
+            return;
+        }
 
-                geo->vertices.clear();
-                geo->indices.clear();
-            }
+        AZStd::lock_guard<AZStd::mutex> lock(m_geometryMutex);
+        if (!geo.inDedupCache)
+        {
+            m_dedupCache.emplace(geo.contentHash, geo.handle);
+            geo.inDedupCache = true;
         }
+    }
 
-        if (transientVertexBuffer.size() > 0)
+    void TuRmlRenderInterface::RemoveFromDedupCache(TuRmlStoredGeometry& geo)
+    {
+        if (!geo.inDedupCache)
         {
-            frameInfo.m_sharedVertexBuffer->UpdateData(
-                    transientVertexBuffer.data(),
-                    totalTransientVertices * sizeof(Rml::Vertex),
-                    0
-                );
+            return;
+        }
 
-            frameInfo.m_sharedIndexBuffer->UpdateData(
-                transientIndexBuffer.data(),
-                totalTransientIndices * sizeof(int),
-                0
-            );
+        auto [begin, end] = m_dedupCache.equal_range(geo.contentHash);
+        for (auto it = begin; it != end; ++it)
+        {
+            if (it->second == geo.handle)
+            {
+                m_dedupCache.erase(it);
+                break;
+            }
         }
+        geo.inDedupCache = false;
+    }
+
+    void TuRmlRenderInterface::CountUpload(const TuRmlVertexFormat& format, size_t vertexCount, size_t indexCount)
+    {
+        m_uploadedGeometryBytes += vertexCount * format.GetVertexStride() + indexCount * format.GetIndexSize();
+        m_uncompactedGeometryBytes += vertexCount * sizeof(Rml::Vertex) + indexCount * sizeof(int);
     }
 
     void TuRmlRenderInterface::OnImGuiUpdate()
     {
         ImGui::Begin("TuRml Render Interface");
         {
-            ImGui::Text("Reusable Buffers: %zu", m_buffers.size());
-            size_t inuseCount = 0;
-            for (auto it = m_buffers.begin(); it != m_buffers.end(); ++it)
+            const auto showHeapStats = [](const char* name, const TuRmlGeometryHeap::Stats& stats)
+            {
+                ImGui::Text("%s: %zu pages, %zu allocations", name, stats.pageCount, stats.allocationCount);
+                ImGui::Text("  Reserved: %zu bytes, Allocated: %zu bytes, Requested: %zu bytes",
+                            stats.reservedBytes, stats.allocatedBytes, stats.requestedBytes);
+                ImGui::Text("  Largest free block: %zu bytes, Fragmentation: %.1f%%",
+                            stats.largestFreeBlock, stats.GetFragmentation() * 100.0f);
+            };
+            showHeapStats("Vertex Heap", m_vertexHeap.GetStats());
+            showHeapStats("Index Heap", m_indexHeap.GetStats());
+            {
+                const double uploaded = static_cast<double>(m_uploadedGeometryBytes);
+                const double uncompacted = static_cast<double>(m_uncompactedGeometryBytes);
+                ImGui::Text("Geometry Uploaded: %.0f bytes, %.1f%% of Rml::Vertex and int indices",
+                            uploaded, uncompacted > 0.0 ? 100.0 * uploaded / uncompacted : 100.0);
+            }
             {
-                const auto& buffer = *it;
-                if (buffer->inUse)
+                AZStd::lock_guard<AZStd::mutex> lock(m_fileTextureMutex);
+                size_t pendingCount = 0;
+                size_t unusedCount = 0;
+                for (const auto& [path, texture] : m_fileTextures)
                 {
-                    inuseCount++;
+                    pendingCount += texture->pending ? 1 : 0;
+                    unusedCount += texture->refCount == 0 ? 1 : 0;
                 }
+                ImGui::Text("File Textures: %zu cached, %zu loading, %zu unused", m_fileTextures.size(), pendingCount,
+                            unusedCount);
+            }
+            {
+                AZStd::lock_guard<AZStd::mutex> lock(m_contextInterfaceMutex);
+                size_t boundCount = 0;
+                size_t createdCount = m_defaultContextInterface->GetCreatedLastFrameCount();
+                for (const auto& contextInterface : m_contextInterfaces)
+                {
+                    boundCount += contextInterface->GetContext() ? 1 : 0;
+                    createdCount += contextInterface->GetCreatedLastFrameCount();
+                }
+                ImGui::Text("Context Render Interfaces: %zu in use, %zu total", boundCount, m_contextInterfaces.size());
+                ImGui::Text("Created Last Frame: %zu geometries", createdCount);
+            }
+            ImGui::Text("Draw List Jobs: %zu, %zu last frame", m_asyncDrawListCount, m_lastDrawListJobCount);
+            {
+                const TuRmlPipelineStateCache::Stats psoStats = m_pipelineStateCache.GetStats();
+                ImGui::Text("Pipeline State Cache: %zu outputs, %zu hits, %zu misses", psoStats.outputCount,
+                            psoStats.hits, psoStats.misses);
+            }
+            {
+                AZStd::lock_guard<AZStd::mutex> lock(m_releaseMutex);
+                ImGui::Text("Deferred Releases: %zu waiting, %zu total, %u frames in flight", m_pendingReleases.size(),
+                            m_deferredReleaseCount, GetFramesInFlight());
+            }
+            ImGui::Text("Handles: %zu geometries, %zu textures, %zu stale lookups", m_geometries.GetSize(),
+                        m_textures.GetSize(), m_geometries.GetStaleLookupCount() + m_textures.GetStaleLookupCount());
+            ImGui::Text("Geometry Records: %zu live in %zu pooled slots", m_geometries.GetSize(),
+                        m_geometries.GetCapacity());
+            for (const auto& [name, stats] : { AZStd::make_pair("Vertex", m_vertexPool.GetStats()),
+                                              AZStd::make_pair("Index", m_indexPool.GetStats()) })
+            {
+                ImGui::Text("%s Buffer Pool: %zu acquires, %zu reused, %zu bytes live, %zu idle (%zu bytes)", name,
+                            stats.acquireCount, stats.reuseCount, stats.liveBytes, stats.idleBuffers,
+                            stats.idleBytes);
+            }
+            {
+                AZStd::lock_guard<AZStd::mutex> lock(m_geometryMutex);
+                const size_t lookups = m_dedupHits + m_dedupMisses;
+                ImGui::Text("Geometry Dedup: %zu cached, %.1f%% hit rate (%zu of %zu), %zu bytes saved",
+                            m_dedupCache.size(), lookups ? 100.0f * m_dedupHits / lookups : 0.0f, m_dedupHits,
+                            lookups, m_dedupBytesSaved);
+            }
+            {
+                AZStd::lock_guard<AZStd::mutex> lock(m_textureSrgMutex);
+                const TuRmlTextureAtlas::Stats atlasStats = m_textureAtlas.GetStats();
+                const size_t atlasPixels = atlasStats.pageCount * TuRmlTextureAtlas::PageSize * TuRmlTextureAtlas::PageSize;
+                ImGui::Text("Texture Atlas: %zu pages, %zu textures, %.1f%% used, %zu defragments",
+                            atlasStats.pageCount, atlasStats.entryCount,
+                            atlasPixels ? 100.0f * atlasStats.usedPixels / atlasPixels : 0.0f,
+                            atlasStats.defragmentCount);
             }
-            ImGui::Text("In Use Count: %zu", inuseCount);
-            ImGui::Text("Created This Frame: %zu geometries", m_createdThisFrame.size());
 
             AzFramework::EntityContextId ctxid;
             AzFramework::GameEntityContextRequestBus::BroadcastResult(
@@ -632,12 +1474,32 @@ namespace TuRml
                 fp->GetChildPasses([](TuRmlChildPass* child)
                 {
                     ImGui::Text("ChildPass %s:", child->GetPathName().GetCStr());
+                    const TuRmlRingBuffer::Stats ringStats = child->m_transientRing.GetStats();
+                    ImGui::Text("Transient Ring: %zu bytes, %zu in flight, %zu this frame",
+                                ringStats.capacity, ringStats.inFlightBytes, ringStats.usedThisFrame);
+                    ImGui::Text("Transient Ring Wraps: %zu, Grows: %zu", ringStats.wrapCount, ringStats.growCount);
+                    ImGui::Text("Reused Frames: %zu%s", child->m_reusedFrameCount,
+                                child->m_reusedFrame ? " (reusing)" : "");
+                    if (child->GetAttachmentImage())
+                    {
+                        ImGui::Text("Skipped Render Target Frames: %zu%s", child->m_skippedFrameCount,
+                                    child->m_renderTargetClean ? " (skipping)" : "");
+                        ImGui::Text("Partial Redraws: %zu, Last Damage: %.1f%%", child->m_partialRedrawCount,
+                                    child->m_damageCoverage * 100.0f);
+                    }
                     for (const auto& frameInfo : child->m_drawCommands.m_drawCommands)
                     {
                         ImGui::Separator();
                         ImGui::Text("FrameInfo:");
-                        ImGui::Text("Shared Vertex Buffer: %zu bytes", frameInfo.m_sharedIndexCapacity);
-                        ImGui::Text("Shared Index Buffer: %zu bytes", frameInfo.m_sharedIndexCapacity);
+                        ImGui::Text("Draws: %zu (%zu before batching, %zu batches, %zu instanced)",
+                                    frameInfo.drawCmds.size(), frameInfo.originalDrawCount, frameInfo.batches.size(),
+                                    frameInfo.instancedDrawCount);
+                        ImGui::Text("Culled Draws: %zu", frameInfo.culledDrawCount);
+                        ImGui::Text("Clip Masks as Scissor: %zu", frameInfo.scissorClipMaskCount);
+                        ImGui::Text("Stencil Clears: %zu (%zu skipped), Clear Fill: %zu px",
+                                    frameInfo.stencilClearCount, frameInfo.stencilClearsSkipped,
+                                    frameInfo.stencilClearArea);
+                        ImGui::Text("State Changes Saved by Reordering: %zu", frameInfo.reorderStateChangesSaved);
                     }
                 });
             }
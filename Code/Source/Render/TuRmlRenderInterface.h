@@ -8,74 +8,140 @@
 
 #include <AzCore/Math/Vector2.h>
 #include <AzCore/Math/PackedVector2.h>
+#include <AzCore/std/containers/deque.h>
+#include <AzCore/std/containers/unordered_map.h>
 #include <AzCore/std/containers/vector.h>
+#include <AzCore/std/string/string.h>
 #include <AzCore/Asset/AssetCommon.h>
+#include <AzCore/Jobs/JobCompletion.h>
 #include <AzCore/Math/Matrix4x4.h>
 #include <AzCore/std/parallel/mutex.h>
+#include <AzCore/std/smart_ptr/unique_ptr.h>
 #include <Atom/RPI.Reflect/Buffer/BufferAsset.h>
 #include <Atom/RPI.Public/Buffer/Buffer.h>
+#include <Atom/RPI.Public/Base.h>
 #include <Atom/RPI.Public/Image/StreamingImage.h>
+#include <Atom/RPI.Public/Shader/Shader.h>
+#include <Atom/RPI.Public/Shader/ShaderResourceGroup.h>
+#include <Atom/RHI.Reflect/ShaderInputNameIndex.h>
 #include <Atom/RHI/IndexBufferView.h>
 #include <Atom/RHI/StreamBufferView.h>
 
+#include <RmlUi/Core/Plugin.h>
 #include <RmlUi/Core/RenderInterface.h>
 
 #include <TuRml/Allocators.h>
 
+#include "TuRmlBufferPool.h"
+#include "TuRmlGeometryHeap.h"
+#include "TuRmlPipelineStateCache.h"
+#include "TuRmlRingBuffer.h"
+#include "TuRmlSlotMap.h"
+#include "TuRmlTextureAtlas.h"
+#include "TuRmlVertexFormat.h"
+
 #include <ImGuiBus.h>
 
 namespace TuRml
 {
     class TuRmlChildPass;
-
-    struct ReusableBuffer
-    {
-        AZ_CLASS_ALLOCATOR(ReusableBuffer, TuRmlRenderAllocator);
-        AZ::Data::Instance<AZ::RPI::Buffer> buffer = {};
-        size_t elementSize = 0;
-        bool inUse = false;
-    };
+    class TuRmlContextRenderInterface;
+    struct FrameInfo;
 
     //! Stored geometry data for compiled RmlUi geometry
     struct TuRmlStoredGeometry
     {
         AZ_CLASS_ALLOCATOR(TuRmlStoredGeometry, TuRmlRenderAllocator);
+        size_t vertexCount = 0;
         size_t indexCount = 0;
-
+        // Indices RmlUi compiled, an analytic anti-aliasing fringe follows them. Clip masks only draw these.
+        size_t coreIndexCount = 0;
+
+        // The slot map handle RmlUi was given
+        Rml::CompiledGeometryHandle handle = 0;
+        // Unique per compiled geometry, slots get reused once geometry is freed
+        AZ::u64 serial = 0;
+        // Of the vertex and index spans, identical content compiled again shares this geometry while it's cached
+        AZ::u64 contentHash = 0;
+        // Each CompileGeometry returning this geometry is matched by a ReleaseGeometry
+        uint32_t refCount = 1;
+        bool inDedupCache = false;
+        // Handed out by deduplication at least once, any context may have drawn it and creatorPass can't be trusted
+        bool shared = false;
+        // Compiled during the frame being recorded, used to tell transient geometry apart in End()
+        bool createdThisFrame = false;
+        // Vertex bounds before translation
+        Rml::Vector2f boundsMin;
+        Rml::Vector2f boundsMax;
+        // Two triangles covering exactly its bounds, clip masks drawn with it can become a scissor rectangle
+        bool axisAlignedRect = false;
+
+        // CPU copy as compiled, the ring and heap copies are made from it. Released once transient geometry is in
+        // the ring and once persistent geometry too big to batch is in the heaps, unless deduplication compares
+        // against it.
         AZStd::vector<Rml::Vertex> vertices;
         AZStd::vector<int> indices;
 
+        // Layout of the ring and heap copies. The CPU copy is always the Rml::Vertex and int data as compiled, it's
+        // never packed or read back from a buffer, so deduplication hashes and compares it exactly.
+        TuRmlVertexFormat format;
+
         enum class StorageType
         {
             Undecided, // Waiting until End() to figure it otu
-            Transient, // Lives in shared dynamic buffer.
-            Persistent,// Has dedicated buffers
+            Transient, // Lives in the pass's transient ring.
+            Persistent,// Sub-allocated from the geometry heaps
         };
         StorageType storageType = StorageType::Undecided;
         TuRmlChildPass* creatorPass = nullptr;
+        // Persistent: has its heap allocations. Transient: has its views into the ring set up.
+        bool uploaded = false;
 
-        size_t vertexOffsetInShared = 0;
-        size_t indexOffsetInShared = 0;
+        // Transient geometry's space in its pass's ring, written by AllocateGPUBuffers and only valid for that frame
+        TuRmlRingBuffer::Allocation ringVertices = {};
+        TuRmlRingBuffer::Allocation ringIndices = {};
 
-        // Persistent buffer assets and instances
-        ReusableBuffer* vertexBuffer = nullptr;
-        ReusableBuffer* indexBuffer = nullptr;
+        // Persistent sub-allocations in the render interface's geometry heaps
+        TuRmlGeometryHeap::Allocation vertexAllocation = {};
+        TuRmlGeometryHeap::Allocation indexAllocation = {};
 
         // Pre-created buffer views for rendering
         AZ::RHI::StreamBufferView vertexBufferView = {};
         AZ::RHI::IndexBufferView indexBufferView = {};
 
-        static void ReleaseGeometry(Rml::CompiledGeometryHandle geometry);
+        //! Has a CPU copy to upload from
+        bool HasData() const;
     };
 
     //! Stored texture data for RmlUi textures
     struct TuRmlStoredTexture
     {
         AZ_CLASS_ALLOCATOR(TuRmlStoredTexture, TuRmlRenderAllocator);
+        // The slot map handle RmlUi was given
+        Rml::TextureHandle handle = 0;
         AZ::Data::Instance<AZ::RPI::StreamingImage> streamingImage = {};
         AZ::PackedVector2i dimensions = AZ::PackedVector2i();
 
         AZ::Data::Asset<AZ::RPI::StreamingImageAsset> textureAsset = {};
+
+        // TextureSrg binding this texture, created and compiled on first use
+        AZ::Data::Instance<AZ::RPI::ShaderResourceGroup> textureSrg = {};
+
+        // Small generated textures live in the render interface's atlas instead of their own image
+        uint32_t atlasEntry = TuRmlTextureAtlas::InvalidEntry;
+
+        bool IsInAtlas() const { return atlasEntry != TuRmlTextureAtlas::InvalidEntry; }
+
+        // Textures loaded from a file are shared through the render interface's file texture cache
+        AZStd::string sourcePath;
+        uint32_t refCount = 0;
+        uint32_t unusedTicks = 0;
+        // The asset is still loading, the placeholder image is bound until it's ready
+        bool pending = false;
+        // RmlUi was given the placeholder's dimensions, it has to reload the texture once the asset is ready
+        bool placeholderDimensions = false;
+        // Holds a reference until ClearPreloadedTextures
+        bool preloaded = false;
     };
 
     //! Collected draw command from RmlUi rendering
@@ -89,6 +155,14 @@ namespace TuRml
 
         Rml::Rectanglei scissorRegion = {};
         bool clipmaskEnabled = false;
+
+        // Maps the texture's UVs into the image it's bound with, offset in xy and scale in zw. From ResolveTextures.
+        AZ::Vector4 uvRect = AZ::Vector4(0.0f, 0.0f, 1.0f, 1.0f);
+
+        // Render target pixels the draw can touch, clipped to the scissor region
+        Rml::Rectanglef bounds = {};
+        // Serial of the drawn geometry, 0 for batches
+        AZ::u64 geometrySerial = 0;
         uint8_t stencilRef = 0;
 
         enum class DrawType
@@ -104,21 +178,61 @@ namespace TuRml
         Rml::ClipMaskOperation clipmask_op = {};
     };
 
+    //! Owns the geometry and textures of all contexts, lookups and releases are safe from any thread.
+    //! Draw lists are recorded by TuRmlContextRenderInterface, contexts created through Rml::CreateContext are
+    //! recorded by a default one that the Rml::RenderInterface overrides here forward to.
     class TuRmlRenderInterface
         : public Rml::RenderInterface
+        , public Rml::Plugin
         , public ImGui::ImGuiUpdateListenerBus::Handler
     {
     public:
         TuRmlRenderInterface();
         ~TuRmlRenderInterface() override;
 
-        void Begin(Rml::Context* ctx, TuRmlChildPass* pass);
-        void End();
-
-        void OnFinishedFrame(TuRmlChildPass* pass, AZ::u8 idx);
-
-        static TuRmlStoredGeometry* GetStoredGeometry(Rml::CompiledGeometryHandle handle) ;
-        static const TuRmlStoredTexture* GetStoredTexture(Rml::TextureHandle handle) ;
+        //! Creates a context with its own render interface, so its draw list can be recorded while other contexts'
+        //! are, see r_rmlParallelContextRecording
+        Rml::Context* CreateContext(const Rml::String& name, Rml::Vector2i dimensions);
+        //! The render interface recording the context, the default one unless it came from CreateContext
+        TuRmlContextRenderInterface& GetContextRenderInterface(Rml::Context* context);
+
+        //! Records the passes' next draw lists on a job, so Rml::Context::Render overlaps with the rest of the frame.
+        //! Called once the contexts are laid out for the frame, waits for the previous job first.
+        void RecordDrawListsAsync(AZStd::vector<AZ::RPI::Ptr<TuRmlChildPass>> passes);
+        //! Returns once the draw list job is done. RmlUi isn't thread safe, nothing may touch it while the job runs.
+        void WaitForDrawLists();
+
+        //! Starts a new frame for deferred releases, called once per tick from the main thread
+        void AdvanceFrame();
+        //! Frees released geometry and textures that no frame in flight can use anymore, called as passes finish
+        void OnFinishedFrame();
+        //! Frames the GPU may be behind the CPU, from r_rmlFramesInFlight
+        static uint32_t GetFramesInFlight();
+
+        //! nullptr for 0 and for handles of geometry or textures that were already freed
+        TuRmlStoredGeometry* GetStoredGeometry(Rml::CompiledGeometryHandle handle);
+        const TuRmlStoredTexture* GetStoredTexture(Rml::TextureHandle handle) const;
+
+        //! Pipeline states shared by all child passes
+        TuRmlPipelineStateCache& GetPipelineStateCache() { return m_pipelineStateCache; }
+
+        //! Resolves the texture srg and UV rect of every draw in a recorded frame, after applying pending atlas page
+        //! changes. Both come from the same atlas layout, which only changes here.
+        void ResolveTextures(FrameInfo& frameInfo);
+
+        //! Bumped whenever a texture srg or UV rect may have changed, reused draw lists resolved them earlier
+        AZ::u64 GetTextureGeneration() const { return m_textureGeneration; }
+        //! Bumped when shared geometry is released, draw lists of other contexts may still draw it
+        AZ::u64 GetGeometryGeneration() const { return m_geometryGeneration; }
+
+        //! Queues loads for file textures so LoadTexture finds them ready, see TuRmlRequests::PreloadTextures.
+        void PreloadTextures(const AZStd::vector<AZStd::string>& texturePaths);
+        void PreloadDocumentTextures(Rml::ElementDocument* document);
+        void ClearPreloadedTextures();
+
+        //! Swaps placeholders for file textures that finished loading and evicts unused ones.
+        //! Called once per tick from the main thread, before the contexts update.
+        void UpdatePendingTextures();
 
 #pragma region Rml::RenderInterface
         //begin Rml::RenderInterface
@@ -142,37 +256,159 @@ namespace TuRml
         void RenderToClipMask(Rml::ClipMaskOperation operation, Rml::CompiledGeometryHandle geometry,
                               Rml::Vector2f translation) override;
 #pragma endregion
-    private:
-        friend class TuRmlChildPass;
 
-        [[nodiscard]] AZStd::vector<struct TuRmlChildPassDrawCommand>& GetDrawCommands() const;
+        // Rml::Plugin
+        int GetEventClasses() override;
+        void OnContextDestroy(Rml::Context* context) override;
 
-        // Allocate GPU buffers for all geometry (called after End(), before rendering)
-        void AllocateGPUBuffers();
+    private:
+        friend class TuRmlChildPass;
+        friend class TuRmlContextRenderInterface;
+
+        // Compiles geometry for the pass being recorded, or outside of a frame for nullptr
+        Rml::CompiledGeometryHandle CompileGeometry(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices,
+                                                    TuRmlChildPass* recordingPass);
+        void ReleaseGeometry(Rml::CompiledGeometryHandle geometry, TuRmlChildPass* recordingPass);
+
+        [[nodiscard]] bool IsBatchable(const TuRmlDrawCommand& cmd);
+
+        // Looks up or starts loading a file texture, m_fileTextureMutex must be held
+        TuRmlStoredTexture* FindOrLoadFileTexture(const AZStd::string& path);
+        // Binds the loaded image of a pending file texture
+        void FinishFileTexture(TuRmlStoredTexture& texture);
+        // Makes img elements showing the texture pick up its real dimensions
+        static void RefreshImageElements(const AZStd::string& path);
+        static AZStd::string ResolveDocumentPath(Rml::ElementDocument* document, const Rml::String& source);
+        const AZ::Data::Instance<AZ::RPI::StreamingImage>& GetPlaceholderImage();
+
+        // Compiled TextureSrg for a texture, a white fallback texture is used for handle 0. Atlased textures return
+        // the srg of their atlas page. Both expect m_textureSrgMutex to be held.
+        AZ::RPI::ShaderResourceGroup* GetTextureSrg(Rml::TextureHandle handle,
+                                                    const AZ::Data::Instance<AZ::RPI::Shader>& shader);
+        AZ::Vector4 GetTextureUvRect(Rml::TextureHandle handle);
+        // Hands atlas images and srgs replaced since the last call to the release queue, m_textureSrgMutex must be held
+        void QueueAtlasPageReleases();
+
+        // Textures sharing an atlas page share a key, so draws using them can still be merged
+        [[nodiscard]] uintptr_t GetTextureBindingKey(Rml::TextureHandle handle);
+
+        // Copies geometry into the heaps from its CPU copy
+        bool UploadPersistentGeometry(TuRmlStoredGeometry& geo);
+
+        // Whether the geometry is two triangles covering exactly the bounds between boundsMin and boundsMax
+        static bool IsAxisAlignedRect(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices,
+                                      Rml::Vector2f boundsMin, Rml::Vector2f boundsMax);
+
+        // Adds a fringe fading to zero coverage outside the sloped outline edges, false if there are none
+        static bool FeatherEdges(Rml::Span<const Rml::Vertex> vertices, Rml::Span<const int> indices,
+                                 AZStd::vector<Rml::Vertex>& featheredVertices, AZStd::vector<int>& featheredIndices);
+
+        // Shares resident geometry with identical content, returns 0 if there is none.
+        // Compares the Rml::Vertex data against the candidates' CPU copies, never their packed buffer form.
+        Rml::CompiledGeometryHandle FindDuplicateGeometry(AZ::u64 contentHash, Rml::Span<const Rml::Vertex> vertices,
+                                                          Rml::Span<const int> indices);
+        // Called by End() once geometry is classified persistent, while it still has its CPU copy
+        void AddToDedupCache(TuRmlStoredGeometry& geo);
+        // m_geometryMutex must be held
+        void RemoveFromDedupCache(TuRmlStoredGeometry& geo);
+
+        // Tracks how much smaller uploads are than Rml::Vertex and int indices
+        void CountUpload(const TuRmlVertexFormat& format, size_t vertexCount, size_t indexCount);
+
+        // Frees the geometry's heap allocations and its slot, once no frame uses it anymore
+        void DestroyGeometry(Rml::CompiledGeometryHandle geometry);
+        // Frees the texture's image or atlas entry and its slot, once no frame uses it anymore
+        void DestroyTexture(Rml::TextureHandle texture);
+
+        // Released geometry and textures wait here until every frame that could still use them has finished
+        struct PendingRelease
+        {
+            enum class Type
+            {
+                Geometry,
+                Texture,
+                // A replaced atlas page image and its srg, dropped once no frame samples them anymore
+                AtlasPage,
+            };
+            Type type = Type::Geometry;
+            uintptr_t handle = 0;
+            // m_frameNumber at the time of release
+            AZ::u64 frame = 0;
+            TuRmlTextureAtlas::Page atlasPage;
+        };
+        void QueueRelease(PendingRelease::Type type, uintptr_t handle);
+        // Destroys the releases made at least framesInFlight frames ago, all of them for 0
+        void ProcessReleases(uint32_t framesInFlight);
+
+        // RmlUi's font engine and texture database are global, draw list jobs take turns calling Rml::Context::Render
+        AZStd::mutex m_rmlRenderMutex;
+
+        // Draw list job from RecordDrawListsAsync, m_drawListsPending until it was waited for
+        AZStd::mutex m_drawListMutex;
+        AZ::JobCompletion m_drawListCompletion;
+        bool m_drawListsPending = false;
+        size_t m_asyncDrawListCount = 0;
+        size_t m_lastDrawListJobCount = 0;
+
+        // Records contexts that weren't created through CreateContext
+        AZStd::unique_ptr<TuRmlContextRenderInterface> m_defaultContextInterface;
+        // Kept until shutdown, RmlUi's render managers hold on to them after their context is destroyed
+        AZStd::mutex m_contextInterfaceMutex;
+        AZStd::vector<AZStd::unique_ptr<TuRmlContextRenderInterface>> m_contextInterfaces;
+
+        AZStd::mutex m_releaseMutex;
+        // In release order, so frames only go up
+        AZStd::deque<PendingRelease> m_pendingReleases;
+        AZStd::atomic_uint64_t m_frameNumber = 0;
+        size_t m_deferredReleaseCount = 0;
+
+        // RmlUi's geometry and texture handles index these, stale handles are caught instead of dereferenced
+        TuRmlSlotMap<TuRmlStoredGeometry> m_geometries;
+        TuRmlSlotMap<TuRmlStoredTexture> m_textures;
+
+        // Context render interfaces record on different threads, guards the heaps, the upload scratch, the dedup
+        // cache and geometry ref counts
+        AZStd::mutex m_geometryMutex;
+
+        // Persistent geometry is sub-allocated from these
+        TuRmlGeometryHeap m_vertexHeap;
+        TuRmlGeometryHeap m_indexHeap;
+        AZStd::atomic_uint64_t m_geometrySerial = 0;
+
+        // CPU copies of geometry are recycled through these
+        TuRmlBufferPool<Rml::Vertex> m_vertexPool;
+        TuRmlBufferPool<int> m_indexPool;
+
+        // Geometry converted from its CPU copy before going into the heaps
+        AZStd::vector<uint8_t> m_uploadScratch;
+
+        // Persistent geometry that kept its CPU copy, so content can be compared exactly, keyed by content hash
+        AZStd::unordered_multimap<AZ::u64, Rml::CompiledGeometryHandle> m_dedupCache;
+        size_t m_dedupHits = 0;
+        size_t m_dedupMisses = 0;
+        size_t m_dedupBytesSaved = 0;
+
+        AZStd::atomic_uint64_t m_uploadedGeometryBytes = 0;
+        AZStd::atomic_uint64_t m_uncompactedGeometryBytes = 0;
+        AZStd::atomic_uint64_t m_textureCreationCount = 0;
+        AZStd::atomic_uint64_t m_textureGeneration = 0;
+        AZStd::atomic_uint64_t m_geometryGeneration = 0;
 
-        ReusableBuffer* RequestBuffer(size_t capacity, size_t elementSize);
+        // Texture srgs are shared by all child passes
+        AZStd::mutex m_textureSrgMutex;
+        AZ::Data::Instance<AZ::RPI::ShaderResourceGroup> m_defaultTextureSrg;
+        AZ::RHI::ShaderInputNameIndex m_textureIndex = "m_texture";
 
-        // Persistent pooled buffers
-        AZStd::vector<AZStd::unique_ptr<ReusableBuffer>> m_buffers;
-        //Once rml tells us to destroy geo's well shove them in here and wait until a pass tells us its done with
-        //it to actually destroy it
-        AZStd::unordered_set<Rml::CompiledGeometryHandle> m_destroyedGeometries;
+        // Guarded by m_textureSrgMutex as well
+        TuRmlTextureAtlas m_textureAtlas;
+        // 1x1 transparent image bound while a file texture loads
+        AZ::Data::Instance<AZ::RPI::StreamingImage> m_placeholderImage;
 
-        AZStd::atomic_uint64_t m_textureCreationCount = 0;
+        TuRmlPipelineStateCache m_pipelineStateCache;
 
-        //Per frame:
-        // Tracking set for geometry created this frame (to detect transients)
-        AZStd::unordered_set<Rml::CompiledGeometryHandle> m_createdThisFrame;
-
-        TuRmlChildPass* m_pass = nullptr;
-        AZ::Matrix4x4 m_transform;
-        AZ::Matrix4x4 m_contextTransform;
-        Rml::Rectanglei m_scissorRegion;
-        Rml::ClipMaskOperation m_clipmaskOperation;
-        uint8_t m_stencilRef = 0;
-        bool m_scissorEnabled = false;
-        bool m_draw_to_clipmask = false;
-        bool m_testClipMask = false;
+        // Keyed by the path RmlUi passes to LoadTexture
+        AZStd::mutex m_fileTextureMutex;
+        AZStd::unordered_map<AZStd::string, TuRmlStoredTexture*> m_fileTextures;
 
         //ImGui
         void OnImGuiUpdate() override;
@@ -0,0 +1,176 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#include "TuRmlRingBuffer.h"
+
+#include <AzCore/Console/ILogger.h>
+#include <AzCore/Math/MathUtils.h>
+#include <Atom/RPI.Public/Buffer/BufferSystemInterface.h>
+
+namespace TuRml
+{
+    TuRmlRingBuffer::TuRmlRingBuffer(const char* name)
+        : m_name(name)
+    {
+    }
+
+    TuRmlRingBuffer::~TuRmlRingBuffer()
+    {
+        ReleaseBuffer();
+        for (RetiredBuffer& retired : m_retiredBuffers)
+        {
+            retired.buffer->Unmap();
+        }
+        m_retiredBuffers.clear();
+    }
+
+    void TuRmlRingBuffer::BeginFrame(uint32_t framesInFlight)
+    {
+        m_frameSlot = (m_frameSlot + 1) % MaxFramesInFlight;
+        // Every slot at least framesInFlight frames old, the oldest one is the slot this frame reuses
+        for (uint32_t age = AZStd::max(framesInFlight, 1u); age <= MaxFramesInFlight; ++age)
+        {
+            size_t& bytes = m_frameBytes[(m_frameSlot + MaxFramesInFlight - age % MaxFramesInFlight) % MaxFramesInFlight];
+            m_inFlightBytes -= bytes;
+            bytes = 0;
+        }
+
+        // Nothing in flight, start from the beginning again to avoid wrapping
+        if (m_inFlightBytes == 0)
+        {
+            m_head = 0;
+        }
+
+        for (auto it = m_retiredBuffers.begin(); it != m_retiredBuffers.end();)
+        {
+            if (--it->framesLeft == 0)
+            {
+                it->buffer->Unmap();
+                it = m_retiredBuffers.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    TuRmlRingBuffer::Allocation TuRmlRingBuffer::Allocate(size_t byteCount, size_t alignment)
+    {
+        if (byteCount == 0)
+        {
+            return {};
+        }
+
+        if (!m_buffer && !Grow(AZStd::max(InitialCapacity, byteCount)))
+        {
+            return {};
+        }
+
+        size_t offset = AZ::SizeAlignUp(m_head, alignment);
+        size_t consumed = offset + byteCount - m_head;
+        bool wrapped = false;
+        if (offset + byteCount > m_capacity)
+        {
+            // Skip the tail end of the buffer and continue from the start
+            offset = 0;
+            consumed = m_capacity - m_head + byteCount;
+            wrapped = true;
+        }
+
+        if (consumed > m_capacity - m_inFlightBytes)
+        {
+            if (!Grow(AZStd::max(m_capacity * 2, byteCount * 2)))
+            {
+                return {};
+            }
+            offset = 0;
+            consumed = byteCount;
+            wrapped = false;
+        }
+
+        if (wrapped)
+        {
+            ++m_wrapCount;
+        }
+
+        m_head = offset + byteCount;
+        m_frameBytes[m_frameSlot] += consumed;
+        m_inFlightBytes += consumed;
+
+        Allocation allocation;
+        allocation.buffer = m_buffer.get();
+        allocation.offset = offset;
+        allocation.data = m_mapped + offset;
+        return allocation;
+    }
+
+    TuRmlRingBuffer::Stats TuRmlRingBuffer::GetStats() const
+    {
+        Stats stats;
+        stats.capacity = m_capacity;
+        stats.inFlightBytes = m_inFlightBytes;
+        stats.usedThisFrame = m_frameBytes[m_frameSlot];
+        stats.wrapCount = m_wrapCount;
+        // The first buffer isn't growth
+        stats.growCount = m_growCount > 0 ? m_growCount - 1 : 0;
+        return stats;
+    }
+
+    bool TuRmlRingBuffer::Grow(size_t minCapacity)
+    {
+        ReleaseBuffer();
+
+        AZ::RPI::CommonBufferDescriptor desc;
+        desc.m_poolType = AZ::RPI::CommonBufferPoolType::DynamicInputAssembly;
+        desc.m_bufferName = m_name;
+        desc.m_byteCount = minCapacity;
+        desc.m_elementSize = sizeof(uint32_t);
+        desc.m_bufferData = nullptr;
+
+        m_buffer = AZ::RPI::BufferSystemInterface::Get()->CreateBufferFromCommonPool(desc);
+        if (!m_buffer)
+        {
+            AZ_Error("TuRmlRingBuffer", false, "Failed to create %zu byte ring buffer %s", minCapacity, m_name.c_str());
+            return false;
+        }
+
+        // Host memory, stays mapped for the lifetime of the buffer
+        auto mappedData = m_buffer->Map(minCapacity, 0);
+        m_mapped = static_cast<uint8_t*>(mappedData[AZ::RHI::MultiDevice::DefaultDeviceIndex]);
+        if (!m_mapped)
+        {
+            AZ_Error("TuRmlRingBuffer", false, "Failed to map ring buffer %s", m_name.c_str());
+            m_buffer.reset();
+            return false;
+        }
+
+        // Everything in flight lives in the retired buffer now
+        m_capacity = minCapacity;
+        m_head = 0;
+        m_inFlightBytes = 0;
+        m_frameBytes = {};
+
+        if (m_growCount++ > 0)
+        {
+            AZ_Info("TuRmlRingBuffer", "Grew %s to %zu bytes", m_name.c_str(), minCapacity);
+        }
+        return true;
+    }
+
+    void TuRmlRingBuffer::ReleaseBuffer()
+    {
+        if (!m_buffer)
+        {
+            return;
+        }
+
+        // Stays mapped until it's destroyed, allocations made earlier in the frame may not be written yet
+        m_mapped = nullptr;
+        m_retiredBuffers.push_back({ AZStd::move(m_buffer), MaxFramesInFlight });
+        m_buffer = nullptr;
+    }
+}
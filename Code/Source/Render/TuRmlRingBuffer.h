@@ -0,0 +1,89 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#pragma once
+
+#include <AzCore/std/containers/array.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzCore/std/string/string.h>
+#include <Atom/RPI.Public/Buffer/Buffer.h>
+#include <Atom/RHI.Reflect/Limits.h>
+
+#include <TuRml/Allocators.h>
+
+namespace TuRml
+{
+    //! Persistently mapped upload ring for transient geometry.
+    //! Space written in a frame is only reused once as many newer frames have begun as there are frames in flight,
+    //! so the GPU is done reading it. When the ring is full it is replaced by a bigger one, the old buffer is kept
+    //! alive and mapped until the frames using it have retired. The ring is write only, it's never read back.
+    class TuRmlRingBuffer
+    {
+    public:
+        AZ_CLASS_ALLOCATOR(TuRmlRingBuffer, TuRmlRenderAllocator);
+
+        //! Upper bound for r_rmlFramesInFlight
+        static constexpr uint32_t MaxFramesInFlight = 3;
+        static_assert(MaxFramesInFlight <= AZ::RHI::Limits::Device::FrameCountMax);
+
+        struct Allocation
+        {
+            AZ::RPI::Buffer* buffer = nullptr;
+            size_t offset = 0;
+            //! Mapped CPU address, only valid during the frame it was allocated in
+            uint8_t* data = nullptr;
+
+            bool IsValid() const { return buffer != nullptr; }
+        };
+
+        struct Stats
+        {
+            size_t capacity = 0;
+            size_t inFlightBytes = 0;
+            size_t usedThisFrame = 0;
+            size_t wrapCount = 0;
+            size_t growCount = 0;
+        };
+
+        explicit TuRmlRingBuffer(const char* name);
+        ~TuRmlRingBuffer();
+
+        //! Retires the space used framesInFlight or more frames ago.
+        void BeginFrame(uint32_t framesInFlight);
+
+        Allocation Allocate(size_t byteCount, size_t alignment);
+
+        Stats GetStats() const;
+
+    private:
+        bool Grow(size_t minCapacity);
+        void ReleaseBuffer();
+
+        static constexpr size_t InitialCapacity = 256 * 1024;
+
+        struct RetiredBuffer
+        {
+            AZ::Data::Instance<AZ::RPI::Buffer> buffer;
+            uint32_t framesLeft = 0;
+        };
+
+        AZStd::string m_name;
+        AZ::Data::Instance<AZ::RPI::Buffer> m_buffer;
+        uint8_t* m_mapped = nullptr;
+        size_t m_capacity = 0;
+        size_t m_head = 0;
+
+        // Bytes consumed by each frame in flight, wrap padding included
+        AZStd::array<size_t, MaxFramesInFlight> m_frameBytes = {};
+        uint32_t m_frameSlot = 0;
+        size_t m_inFlightBytes = 0;
+
+        AZStd::vector<RetiredBuffer> m_retiredBuffers;
+
+        size_t m_wrapCount = 0;
+        size_t m_growCount = 0;
+    };
+}
@@ -0,0 +1,170 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#pragma once
+
+#include <AzCore/std/containers/array.h>
+#include <AzCore/std/limits.h>
+#include <AzCore/std/parallel/atomic.h>
+#include <AzCore/std/parallel/mutex.h>
+#include <AzCore/std/smart_ptr/unique_ptr.h>
+
+#include <TuRml/Allocators.h>
+
+namespace TuRml
+{
+    //! Stores values in fixed size chunks of contiguous slots and hands out generation-checked handles.
+    //! A handle is the slot's generation in the upper 32 bits and its index + 1 in the lower ones, so 0 is never
+    //! valid. Removing a value bumps the slot's generation, handles to it are detected as stale from then on.
+    //! Values never move, pointers from Get stay valid until the value is removed.
+    //! Emplace and Remove are serialised internally, Get doesn't lock.
+    template<typename T, uint32_t ChunkSize = 256, uint32_t MaxChunks = 1024>
+    class TuRmlSlotMap
+    {
+    public:
+        AZ_CLASS_ALLOCATOR(TuRmlSlotMap, TuRmlRenderAllocator);
+
+        using Handle = uintptr_t;
+        static_assert(sizeof(Handle) == sizeof(AZ::u64), "Handles pack a generation and an index into 64 bits");
+
+        TuRmlSlotMap() = default;
+        TuRmlSlotMap(const TuRmlSlotMap&) = delete;
+        TuRmlSlotMap& operator=(const TuRmlSlotMap&) = delete;
+
+        //! Returns 0 once all MaxChunks * ChunkSize slots are in use
+        Handle Emplace()
+        {
+            AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+            if (m_freeHead == InvalidIndex && !AddChunk())
+            {
+                return 0;
+            }
+
+            const uint32_t index = m_freeHead;
+            Slot& slot = GetSlot(index);
+            m_freeHead = slot.nextFree;
+            slot.alive = true;
+            ++m_size;
+            return MakeHandle(slot.generation, index);
+        }
+
+        //! Resets the value and invalidates handles to it, returns false for stale handles
+        bool Remove(Handle handle)
+        {
+            AZStd::lock_guard<AZStd::mutex> lock(m_mutex);
+            Slot* slot = Find(handle);
+            if (!slot)
+            {
+                return false;
+            }
+
+            slot->value = T{};
+            slot->alive = false;
+            // Skips 0 on wrap around, so a recycled slot never hands out a handle that compares equal to 0
+            slot->generation = slot->generation == AZStd::numeric_limits<uint32_t>::max() ? 1 : slot->generation + 1;
+            slot->nextFree = m_freeHead;
+            m_freeHead = GetIndex(handle);
+            --m_size;
+            return true;
+        }
+
+        //! nullptr for 0 and for stale handles
+        T* Get(Handle handle)
+        {
+            Slot* slot = Find(handle);
+            return slot ? &slot->value : nullptr;
+        }
+
+        const T* Get(Handle handle) const
+        {
+            return const_cast<TuRmlSlotMap*>(this)->Get(handle);
+        }
+
+        size_t GetSize() const { return m_size; }
+        //! Slots allocated so far, values are constructed in place there and recycled
+        size_t GetCapacity() const { return static_cast<size_t>(m_chunkCount) * ChunkSize; }
+        //! Lookups with a handle whose value was already removed
+        size_t GetStaleLookupCount() const { return m_staleLookups; }
+
+    private:
+        static constexpr uint32_t InvalidIndex = AZStd::numeric_limits<uint32_t>::max();
+
+        struct Slot
+        {
+            T value = {};
+            uint32_t generation = 1;
+            uint32_t nextFree = InvalidIndex;
+            bool alive = false;
+        };
+
+        struct Chunk
+        {
+            AZ_CLASS_ALLOCATOR(Chunk, TuRmlRenderAllocator);
+            AZStd::array<Slot, ChunkSize> slots;
+        };
+
+        static Handle MakeHandle(uint32_t generation, uint32_t index)
+        {
+            return static_cast<Handle>(static_cast<AZ::u64>(generation) << 32 | (static_cast<AZ::u64>(index) + 1));
+        }
+        static uint32_t GetIndex(Handle handle) { return static_cast<uint32_t>(handle & 0xFFFFFFFF) - 1; }
+        static uint32_t GetGeneration(Handle handle) { return static_cast<uint32_t>(static_cast<AZ::u64>(handle) >> 32); }
+
+        Slot& GetSlot(uint32_t index) { return m_chunks[index / ChunkSize]->slots[index % ChunkSize]; }
+
+        Slot* Find(Handle handle)
+        {
+            if ((handle & 0xFFFFFFFF) == 0)
+            {
+                return nullptr;
+            }
+
+            const uint32_t index = GetIndex(handle);
+            if (index >= m_chunkCount * ChunkSize)
+            {
+                ++m_staleLookups;
+                return nullptr;
+            }
+
+            Slot& slot = GetSlot(index);
+            if (!slot.alive || slot.generation != GetGeneration(handle))
+            {
+                ++m_staleLookups;
+                return nullptr;
+            }
+            return &slot;
+        }
+
+        bool AddChunk()
+        {
+            if (m_chunkCount == MaxChunks)
+            {
+                AZ_Error("TuRmlSlotMap", false, "All %u slots are in use", MaxChunks * ChunkSize);
+                return false;
+            }
+
+            auto chunk = AZStd::make_unique<Chunk>();
+            const uint32_t firstIndex = m_chunkCount * ChunkSize;
+            for (uint32_t i = 0; i < ChunkSize; ++i)
+            {
+                chunk->slots[i].nextFree = i + 1 < ChunkSize ? firstIndex + i + 1 : InvalidIndex;
+            }
+            m_chunks[m_chunkCount] = AZStd::move(chunk);
+            m_freeHead = firstIndex;
+            // Published last, readers only look at chunks below the count
+            ++m_chunkCount;
+            return true;
+        }
+
+        // Fixed table, so readers never see it reallocate
+        AZStd::array<AZStd::unique_ptr<Chunk>, MaxChunks> m_chunks;
+        AZStd::atomic<uint32_t> m_chunkCount = 0;
+        uint32_t m_freeHead = InvalidIndex;
+        size_t m_size = 0;
+        AZStd::atomic<size_t> m_staleLookups = 0;
+        AZStd::mutex m_mutex;
+    };
+}
@@ -0,0 +1,447 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#include "TuRmlTextureAtlas.h"
+
+#include <AzCore/Console/ILogger.h>
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/sort.h>
+#include <Atom/RPI.Public/Image/ImageSystemInterface.h>
+#include <Atom/RPI.Public/Image/StreamingImagePool.h>
+
+namespace TuRml
+{
+    static constexpr uint32_t BytesPerPixel = 4;
+
+    TuRmlTextureAtlas::~TuRmlTextureAtlas()
+    {
+        const Stats stats = GetStats();
+        AZ_Warning("TuRmlTextureAtlas", stats.entryCount == 0, "Still %zu atlas entries on destruction", stats.entryCount);
+    }
+
+    bool TuRmlTextureAtlas::AllocateRect(PageData& page, uint32_t width, uint32_t height, uint32_t& x, uint32_t& y)
+    {
+        // Best fit: the shelf wasting the least height, then the narrowest span on it that fits
+        Shelf* bestShelf = nullptr;
+        size_t bestSpan = 0;
+        uint32_t bestWaste = AZStd::numeric_limits<uint32_t>::max();
+        for (Shelf& shelf : page.shelves)
+        {
+            const bool shelfEmpty = shelf.spans.size() == 1 && shelf.spans[0].free;
+            // Don't let short textures claim tall shelves, unless nothing else is using the shelf
+            if (shelf.height < height || (!shelfEmpty && shelf.height > height + height / 2))
+            {
+                continue;
+            }
+
+            for (size_t i = 0; i < shelf.spans.size(); ++i)
+            {
+                const Span& span = shelf.spans[i];
+                if (!span.free || span.width < width)
+                {
+                    continue;
+                }
+
+                const uint32_t waste = (shelf.height - height) * PageSize + (span.width - width);
+                if (waste < bestWaste)
+                {
+                    bestShelf = &shelf;
+                    bestSpan = i;
+                    bestWaste = waste;
+                }
+            }
+        }
+
+        if (!bestShelf)
+        {
+            if (width > PageSize || page.nextShelfY + height > PageSize)
+            {
+                return false;
+            }
+
+            Shelf shelf;
+            shelf.y = page.nextShelfY;
+            shelf.height = height;
+            shelf.spans.push_back({ 0, PageSize, true });
+            page.shelves.push_back(AZStd::move(shelf));
+            page.nextShelfY += height;
+
+            bestShelf = &page.shelves.back();
+            bestSpan = 0;
+        }
+
+        Span& span = bestShelf->spans[bestSpan];
+        x = span.x;
+        y = bestShelf->y;
+        if (span.width > width)
+        {
+            const Span remainder{ span.x + width, span.width - width, true };
+            span.width = width;
+            span.free = false;
+            bestShelf->spans.insert(bestShelf->spans.begin() + bestSpan + 1, remainder);
+        }
+        else
+        {
+            span.free = false;
+        }
+        return true;
+    }
+
+    void TuRmlTextureAtlas::FreeRect(PageData& page, uint32_t x, uint32_t y)
+    {
+        auto shelfIt = AZStd::find_if(page.shelves.begin(), page.shelves.end(),
+                                      [y](const Shelf& shelf) { return shelf.y == y; });
+        if (shelfIt == page.shelves.end())
+        {
+            return;
+        }
+
+        auto& spans = shelfIt->spans;
+        auto spanIt = AZStd::find_if(spans.begin(), spans.end(), [x](const Span& span) { return span.x == x; });
+        if (spanIt == spans.end())
+        {
+            return;
+        }
+
+        spanIt->free = true;
+
+        // Merge with free neighbours
+        size_t index = spanIt - spans.begin();
+        if (index + 1 < spans.size() && spans[index + 1].free)
+        {
+            spans[index].width += spans[index + 1].width;
+            spans.erase(spans.begin() + index + 1);
+        }
+        if (index > 0 && spans[index - 1].free)
+        {
+            spans[index - 1].width += spans[index].width;
+            spans.erase(spans.begin() + index);
+        }
+
+        // Empty shelves at the bottom give their height back to the page
+        while (!page.shelves.empty())
+        {
+            const Shelf& last = page.shelves.back();
+            if (last.spans.size() != 1 || !last.spans[0].free)
+            {
+                break;
+            }
+            page.nextShelfY = last.y;
+            page.shelves.pop_back();
+        }
+    }
+
+    uint32_t TuRmlTextureAtlas::CreatePage()
+    {
+        auto page = AZStd::make_unique<PageData>();
+        page->pixels.resize(size_t(PageSize) * PageSize * BytesPerPixel, 0);
+
+        for (uint32_t i = 0; i < m_pages.size(); ++i)
+        {
+            if (!m_pages[i])
+            {
+                m_pages[i] = AZStd::move(page);
+                AZ_Info("TuRmlTextureAtlas", "Allocated atlas page #%u", i);
+                return i;
+            }
+        }
+
+        m_pages.push_back(AZStd::move(page));
+        AZ_Info("TuRmlTextureAtlas", "Allocated atlas page #%zu", m_pages.size() - 1);
+        return static_cast<uint32_t>(m_pages.size() - 1);
+    }
+
+    bool TuRmlTextureAtlas::CreatePageImage(PageData& page)
+    {
+        AZ::Data::Instance<AZ::RPI::StreamingImagePool> streamingImagePool = AZ::RPI::ImageSystemInterface::Get()->
+            GetSystemStreamingPool();
+
+        // A new image instead of rewriting the old one, frames still in flight keep sampling the old one
+        auto image = AZ::RPI::StreamingImage::CreateFromCpuData(
+            *streamingImagePool,
+            AZ::RHI::ImageDimension::Image2D,
+            AZ::RHI::Size(PageSize, PageSize, 1),
+            AZ::RHI::Format::R8G8B8A8_UNORM,
+            page.pixels.data(),
+            page.pixels.size(),
+            AZ::Uuid::CreateRandom()
+        );
+
+        if (!image)
+        {
+            AZ_Error("TuRmlTextureAtlas", false, "Failed to create %ux%u atlas page", PageSize, PageSize);
+            return false;
+        }
+
+        if (image->GetRHIImage())
+        {
+            image->GetRHIImage()->SetName(AZ::Name(AZStd::string::format("TuRml Atlas Page #%p", &page)));
+        }
+
+        RetirePageImage(page);
+        page.image = image;
+        return true;
+    }
+
+    void TuRmlTextureAtlas::RetirePageImage(PageData& page)
+    {
+        if (page.image)
+        {
+            m_retiredPages.push_back({ AZStd::move(page.image), AZStd::move(page.textureSrg) });
+        }
+        page.image.reset();
+        page.textureSrg.reset();
+    }
+
+    bool TuRmlTextureAtlas::UpdatePageImages()
+    {
+        bool changed = false;
+        for (uint32_t pageIndex = 0; pageIndex < m_pages.size(); ++pageIndex)
+        {
+            if (!m_pages[pageIndex])
+            {
+                continue;
+            }
+
+            PageData& page = *m_pages[pageIndex];
+            if (page.needsDefragment)
+            {
+                Defragment(pageIndex);
+            }
+            if (page.dirty)
+            {
+                CreatePageImage(page);
+                page.dirty = false;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    AZStd::vector<TuRmlTextureAtlas::Page> TuRmlTextureAtlas::TakeRetiredPages()
+    {
+        return AZStd::move(m_retiredPages);
+    }
+
+    void TuRmlTextureAtlas::WriteEntry(PageData& page, const Entry& entry, const uint8_t* rgba)
+    {
+        const uint32_t innerWidth = entry.width - 2 * Padding;
+        const uint32_t innerHeight = entry.height - 2 * Padding;
+        const size_t srcPitch = size_t(innerWidth) * BytesPerPixel;
+
+        // The border repeats the edge pixels, so filtering at the edges behaves like clamp addressing
+        for (uint32_t row = 0; row < entry.height; ++row)
+        {
+            const uint32_t srcRow = AZStd::clamp(row, Padding, innerHeight + Padding - 1) - Padding;
+            const uint8_t* src = rgba + srcRow * srcPitch;
+            uint8_t* dst = page.pixels.data() + ((size_t(entry.y) + row) * PageSize + entry.x) * BytesPerPixel;
+
+            memcpy(dst + Padding * BytesPerPixel, src, srcPitch);
+            for (uint32_t i = 0; i < Padding; ++i)
+            {
+                memcpy(dst + i * BytesPerPixel, src, BytesPerPixel);
+                memcpy(dst + (Padding + innerWidth + i) * BytesPerPixel, src + srcPitch - BytesPerPixel, BytesPerPixel);
+            }
+        }
+    }
+
+    uint32_t TuRmlTextureAtlas::Add(const uint8_t* rgba, uint32_t width, uint32_t height)
+    {
+        const uint32_t paddedWidth = width + 2 * Padding;
+        const uint32_t paddedHeight = height + 2 * Padding;
+        if (!rgba || width == 0 || height == 0 || paddedWidth > PageSize || paddedHeight > PageSize)
+        {
+            return InvalidEntry;
+        }
+
+        Entry entry;
+        entry.width = paddedWidth;
+        entry.height = paddedHeight;
+        entry.alive = true;
+
+        bool placed = false;
+        for (uint32_t pageIndex = 0; pageIndex < m_pages.size() && !placed; ++pageIndex)
+        {
+            if (m_pages[pageIndex] && AllocateRect(*m_pages[pageIndex], paddedWidth, paddedHeight, entry.x, entry.y))
+            {
+                entry.pageIndex = pageIndex;
+                placed = true;
+            }
+        }
+
+        if (!placed)
+        {
+            entry.pageIndex = CreatePage();
+            if (!AllocateRect(*m_pages[entry.pageIndex], paddedWidth, paddedHeight, entry.x, entry.y))
+            {
+                return InvalidEntry;
+            }
+        }
+
+        // Only the CPU copy changes here, UpdatePageImages uploads it as a new image
+        PageData& page = *m_pages[entry.pageIndex];
+        WriteEntry(page, entry, rgba);
+        page.dirty = true;
+
+        page.usedPixels += size_t(entry.width) * entry.height;
+        ++page.entryCount;
+
+        uint32_t entryId;
+        if (!m_freeEntries.empty())
+        {
+            entryId = m_freeEntries.back();
+            m_freeEntries.pop_back();
+            m_entries[entryId] = entry;
+        }
+        else
+        {
+            entryId = static_cast<uint32_t>(m_entries.size());
+            m_entries.push_back(entry);
+        }
+        return entryId;
+    }
+
+    void TuRmlTextureAtlas::Remove(uint32_t entryId)
+    {
+        if (entryId >= m_entries.size() || !m_entries[entryId].alive)
+        {
+            return;
+        }
+
+        Entry& entry = m_entries[entryId];
+        entry.alive = false;
+        m_freeEntries.push_back(entryId);
+
+        const uint32_t pageIndex = entry.pageIndex;
+        PageData& page = *m_pages[pageIndex];
+        FreeRect(page, entry.x, entry.y);
+        page.usedPixels -= size_t(entry.width) * entry.height;
+        --page.entryCount;
+
+        if (page.entryCount == 0)
+        {
+            size_t livePages = 0;
+            for (const auto& other : m_pages)
+            {
+                livePages += other ? 1 : 0;
+            }
+
+            if (livePages > 1)
+            {
+                AZ_Info("TuRmlTextureAtlas", "Released empty atlas page #%u", pageIndex);
+                RetirePageImage(page);
+                m_pages[pageIndex].reset();
+            }
+            return;
+        }
+
+        // Repack once less than half of the claimed shelf area is still in use
+        const size_t claimedPixels = size_t(page.nextShelfY) * PageSize;
+        if (page.nextShelfY > PageSize / 4 && page.usedPixels * 2 < claimedPixels)
+        {
+            page.needsDefragment = true;
+        }
+    }
+
+    void TuRmlTextureAtlas::Defragment(uint32_t pageIndex)
+    {
+        PageData& page = *m_pages[pageIndex];
+        page.needsDefragment = false;
+
+        AZStd::vector<uint32_t> liveEntries;
+        liveEntries.reserve(page.entryCount);
+        for (uint32_t i = 0; i < m_entries.size(); ++i)
+        {
+            if (m_entries[i].alive && m_entries[i].pageIndex == pageIndex)
+            {
+                liveEntries.push_back(i);
+            }
+        }
+
+        // Tallest first packs shelves tightly
+        AZStd::sort(liveEntries.begin(), liveEntries.end(), [this](uint32_t lhs, uint32_t rhs)
+        {
+            return m_entries[lhs].height > m_entries[rhs].height;
+        });
+
+        PageData packed;
+        packed.pixels.resize(page.pixels.size(), 0);
+        AZStd::vector<AZStd::pair<uint32_t, uint32_t>> positions;
+        positions.reserve(liveEntries.size());
+        for (uint32_t entryId : liveEntries)
+        {
+            const Entry& entry = m_entries[entryId];
+            uint32_t x, y;
+            if (!AllocateRect(packed, entry.width, entry.height, x, y))
+            {
+                // Can't happen with fewer pixels in use, but keep the old layout rather than lose anything
+                return;
+            }
+            positions.emplace_back(x, y);
+
+            // Borders were already extruded, copy the padded rect as is
+            const size_t rowBytes = size_t(entry.width) * BytesPerPixel;
+            for (uint32_t row = 0; row < entry.height; ++row)
+            {
+                memcpy(packed.pixels.data() + ((size_t(y) + row) * PageSize + x) * BytesPerPixel,
+                       page.pixels.data() + ((size_t(entry.y) + row) * PageSize + entry.x) * BytesPerPixel,
+                       rowBytes);
+            }
+        }
+
+        const uint32_t oldShelfY = page.nextShelfY;
+        page.shelves = AZStd::move(packed.shelves);
+        page.nextShelfY = packed.nextShelfY;
+        page.pixels = AZStd::move(packed.pixels);
+        for (size_t i = 0; i < liveEntries.size(); ++i)
+        {
+            m_entries[liveEntries[i]].x = positions[i].first;
+            m_entries[liveEntries[i]].y = positions[i].second;
+        }
+
+        page.dirty = true;
+        ++m_defragmentCount;
+        AZ_Info("TuRmlTextureAtlas", "Defragmented atlas page #%u, %zu entries, shelves %u -> %u pixels high",
+                pageIndex, liveEntries.size(), oldShelfY, page.nextShelfY);
+    }
+
+    AZ::Vector4 TuRmlTextureAtlas::GetUvRect(uint32_t entryId) const
+    {
+        const Entry& entry = m_entries[entryId];
+        constexpr float InvPageSize = 1.0f / static_cast<float>(PageSize);
+        return AZ::Vector4(
+            static_cast<float>(entry.x + Padding) * InvPageSize,
+            static_cast<float>(entry.y + Padding) * InvPageSize,
+            static_cast<float>(entry.width - 2 * Padding) * InvPageSize,
+            static_cast<float>(entry.height - 2 * Padding) * InvPageSize);
+    }
+
+    TuRmlTextureAtlas::Page* TuRmlTextureAtlas::GetPage(uint32_t entryId)
+    {
+        return m_pages[m_entries[entryId].pageIndex].get();
+    }
+
+    uintptr_t TuRmlTextureAtlas::GetBindingKey(uint32_t entryId) const
+    {
+        return reinterpret_cast<uintptr_t>(m_pages[m_entries[entryId].pageIndex].get());
+    }
+
+    TuRmlTextureAtlas::Stats TuRmlTextureAtlas::GetStats() const
+    {
+        Stats stats;
+        for (const auto& page : m_pages)
+        {
+            if (page)
+            {
+                ++stats.pageCount;
+                stats.entryCount += page->entryCount;
+                stats.usedPixels += page->usedPixels;
+            }
+        }
+        stats.defragmentCount = m_defragmentCount;
+        return stats;
+    }
+}
@@ -0,0 +1,124 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#pragma once
+
+#include <AzCore/Math/Vector4.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzCore/std/limits.h>
+#include <AzCore/std/smart_ptr/unique_ptr.h>
+#include <Atom/RPI.Public/Image/StreamingImage.h>
+#include <Atom/RPI.Public/Shader/ShaderResourceGroup.h>
+
+#include <TuRml/Allocators.h>
+
+namespace TuRml
+{
+    //! Packs small RGBA8 textures into shared pages using shelf packing, so draws using different
+    //! generated textures can share one texture binding. Each entry gets a one pixel extruded border
+    //! to keep bilinear filtering from bleeding between neighbours.
+    //! Pages keep a CPU copy of their pixels. Adding and removing only change that copy, UpdatePageImages repacks
+    //! pages that have too much freed space and uploads changed pages as new images, so an image is never written
+    //! while frames in flight may sample it. Replaced images are handed out through TakeRetiredPages.
+    class TuRmlTextureAtlas
+    {
+    public:
+        AZ_CLASS_ALLOCATOR(TuRmlTextureAtlas, TuRmlRenderAllocator);
+
+        static constexpr uint32_t PageSize = 1024;
+        static constexpr uint32_t Padding = 1;
+        static constexpr uint32_t InvalidEntry = AZStd::numeric_limits<uint32_t>::max();
+
+        struct Page
+        {
+            AZ::Data::Instance<AZ::RPI::StreamingImage> image;
+            //! Filled in by the render interface, reset whenever the image is replaced
+            AZ::Data::Instance<AZ::RPI::ShaderResourceGroup> textureSrg;
+        };
+
+        struct Stats
+        {
+            size_t pageCount = 0;
+            size_t entryCount = 0;
+            size_t usedPixels = 0;
+            size_t defragmentCount = 0;
+        };
+
+        TuRmlTextureAtlas() = default;
+        ~TuRmlTextureAtlas();
+
+        //! Returns InvalidEntry if the texture doesn't fit in a page
+        uint32_t Add(const uint8_t* rgba, uint32_t width, uint32_t height);
+        void Remove(uint32_t entryId);
+
+        //! Repacks fragmented pages and recreates the images of changed ones, returns whether any image changed.
+        //! UV rects and page images only change here.
+        bool UpdatePageImages();
+        //! Images and srgs replaced or released since the last call, frames in flight may still use them
+        AZStd::vector<Page> TakeRetiredPages();
+
+        //! Offset in xy and scale in zw, maps the texture's own UVs into the page
+        AZ::Vector4 GetUvRect(uint32_t entryId) const;
+        Page* GetPage(uint32_t entryId);
+        //! Identifies the texture binding an entry draws with, entries on the same page compare equal
+        uintptr_t GetBindingKey(uint32_t entryId) const;
+
+        Stats GetStats() const;
+
+    private:
+        struct Span
+        {
+            uint32_t x = 0;
+            uint32_t width = 0;
+            bool free = true;
+        };
+
+        struct Shelf
+        {
+            uint32_t y = 0;
+            uint32_t height = 0;
+            AZStd::vector<Span> spans;
+        };
+
+        struct PageData : Page
+        {
+            AZStd::vector<Shelf> shelves;
+            uint32_t nextShelfY = 0;
+            size_t usedPixels = 0;
+            size_t entryCount = 0;
+            AZStd::vector<uint8_t> pixels;
+            // The CPU copy changed since the image was created
+            bool dirty = false;
+            bool needsDefragment = false;
+        };
+
+        struct Entry
+        {
+            uint32_t pageIndex = 0;
+            //! Top left of the padded rect
+            uint32_t x = 0;
+            uint32_t y = 0;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            bool alive = false;
+        };
+
+        static bool AllocateRect(PageData& page, uint32_t width, uint32_t height, uint32_t& x, uint32_t& y);
+        static void FreeRect(PageData& page, uint32_t x, uint32_t y);
+
+        uint32_t CreatePage();
+        bool CreatePageImage(PageData& page);
+        void WriteEntry(PageData& page, const Entry& entry, const uint8_t* rgba);
+        void RetirePageImage(PageData& page);
+        void Defragment(uint32_t pageIndex);
+
+        AZStd::vector<AZStd::unique_ptr<PageData>> m_pages;
+        AZStd::vector<Entry> m_entries;
+        AZStd::vector<uint32_t> m_freeEntries;
+        AZStd::vector<Page> m_retiredPages;
+        size_t m_defragmentCount = 0;
+    };
+}
@@ -0,0 +1,107 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#include "TuRmlVertexFormat.h"
+
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/limits.h>
+
+namespace TuRml
+{
+    static constexpr size_t MaxShortIndexVertices = size_t(AZStd::numeric_limits<uint16_t>::max()) + 1;
+
+    // Only normal halves and zero, anything that would lose mantissa bits or range fails
+    static bool FloatToHalfExact(float value, uint16_t& half)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        const uint32_t sign = (bits >> 16) & 0x8000;
+        const int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127;
+        const uint32_t mantissa = bits & 0x7FFFFF;
+
+        if ((bits & 0x7FFFFFFF) == 0)
+        {
+            half = static_cast<uint16_t>(sign);
+            return true;
+        }
+        if (exponent < -14 || exponent > 15 || (mantissa & 0x1FFF) != 0)
+        {
+            return false;
+        }
+
+        half = static_cast<uint16_t>(sign | static_cast<uint32_t>(exponent + 15) << 10 | mantissa >> 13);
+        return true;
+    }
+
+    static uint16_t FloatToUnorm16(float value)
+    {
+        return static_cast<uint16_t>(AZStd::clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+    }
+
+    TuRmlVertexFormat TuRmlVertexFormat::Choose(const Rml::Vertex* vertices, size_t vertexCount)
+    {
+        TuRmlVertexFormat format;
+        format.shortIndices = vertexCount <= MaxShortIndexVertices;
+
+        format.compactVertices = true;
+        uint16_t half;
+        for (size_t i = 0; i < vertexCount && format.compactVertices; ++i)
+        {
+            const Rml::Vertex& vertex = vertices[i];
+            format.compactVertices = FloatToHalfExact(vertex.position.x, half) &&
+                FloatToHalfExact(vertex.position.y, half) &&
+                vertex.tex_coord.x >= 0.0f && vertex.tex_coord.x <= 1.0f &&
+                vertex.tex_coord.y >= 0.0f && vertex.tex_coord.y <= 1.0f;
+        }
+        return format;
+    }
+
+    void TuRmlVertexFormat::WriteVertices(const Rml::Vertex* vertices, size_t count, void* destination) const
+    {
+        if (!compactVertices)
+        {
+            memcpy(destination, vertices, count * sizeof(Rml::Vertex));
+            return;
+        }
+
+        auto* compact = static_cast<TuRmlCompactVertex*>(destination);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Rml::Vertex& vertex = vertices[i];
+            TuRmlCompactVertex& packed = compact[i];
+            FloatToHalfExact(vertex.position.x, packed.position[0]);
+            FloatToHalfExact(vertex.position.y, packed.position[1]);
+            packed.colour = vertex.colour;
+            packed.texCoord[0] = FloatToUnorm16(vertex.tex_coord.x);
+            packed.texCoord[1] = FloatToUnorm16(vertex.tex_coord.y);
+        }
+    }
+
+    void TuRmlVertexFormat::WriteIndices(const int* indices, size_t count, void* destination, int baseVertex) const
+    {
+        if (shortIndices)
+        {
+            auto* packedIndices = static_cast<uint16_t*>(destination);
+            for (size_t i = 0; i < count; ++i)
+            {
+                packedIndices[i] = static_cast<uint16_t>(indices[i] + baseVertex);
+            }
+        }
+        else if (baseVertex == 0)
+        {
+            memcpy(destination, indices, count * sizeof(int));
+        }
+        else
+        {
+            auto* intIndices = static_cast<int*>(destination);
+            for (size_t i = 0; i < count; ++i)
+            {
+                intIndices[i] = indices[i] + baseVertex;
+            }
+        }
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2025 Reece Hagan
+ *
+ * For complete copyright and license terms please see the LICENSE at the root of this distribution.
+ */
+#pragma once
+
+#include <Atom/RHI.Reflect/Format.h>
+#include <Atom/RHI/IndexBufferView.h>
+
+#include <RmlUi/Core/Vertex.h>
+
+namespace TuRml
+{
+    //! Vertex as uploaded for geometry that fits it, 12 bytes instead of the 20 of Rml::Vertex.
+    //! Positions are half floats, UVs 16 bit unorm.
+    struct TuRmlCompactVertex
+    {
+        uint16_t position[2];
+        Rml::ColourbPremultiplied colour;
+        uint16_t texCoord[2];
+    };
+    static_assert(sizeof(TuRmlCompactVertex) == 12, "TuRmlCompactVertex must match the compact input layout");
+
+    //! How a geometry or batch is laid out in its GPU buffers
+    struct TuRmlVertexFormat
+    {
+        //! TuRmlCompactVertex instead of Rml::Vertex
+        bool compactVertices = false;
+        //! uint16_t instead of int indices
+        bool shortIndices = false;
+
+        //! Compact if every position converts to a half float exactly and all UVs are within [0, 1].
+        //! Short indices whenever there are few enough vertices to address.
+        static TuRmlVertexFormat Choose(const Rml::Vertex* vertices, size_t vertexCount);
+
+        size_t GetVertexStride() const { return compactVertices ? sizeof(TuRmlCompactVertex) : sizeof(Rml::Vertex); }
+        size_t GetIndexSize() const { return shortIndices ? sizeof(uint16_t) : sizeof(int); }
+        AZ::RHI::IndexFormat GetIndexFormat() const
+        {
+            return shortIndices ? AZ::RHI::IndexFormat::Uint16 : AZ::RHI::IndexFormat::Uint32;
+        }
+        AZ::RHI::Format GetPositionFormat() const
+        {
+            return compactVertices ? AZ::RHI::Format::R16G16_FLOAT : AZ::RHI::Format::R32G32_FLOAT;
+        }
+        AZ::RHI::Format GetTexCoordFormat() const
+        {
+            return compactVertices ? AZ::RHI::Format::R16G16_UNORM : AZ::RHI::Format::R32G32_FLOAT;
+        }
+
+        //! Converts into the buffer layout, destination holds count * GetVertexStride() bytes
+        void WriteVertices(const Rml::Vertex* vertices, size_t count, void* destination) const;
+        //! baseVertex is added to every index
+        void WriteIndices(const int* indices, size_t count, void* destination, int baseVertex = 0) const;
+    };
+}
@@ -16,6 +16,10 @@ set(FILES
     Source/Clients/Interfaces/TuSystem.cpp
     Source/Clients/TuRmlSystemComponent.cpp
     Source/Clients/TuRmlSystemComponent.h
+    Source/Clients/TuRmlContextScheduler.h
+    Source/Clients/TuRmlContextScheduler.cpp
+    Source/Clients/TuRmlContextTracker.h
+    Source/Clients/TuRmlContextTracker.cpp
     Source/Console/TuRmlConsoleDocument.h
     Source/Console/TuRmlConsoleDocument.cpp
     Source/Render/TuRmlFeatureProcessor.h
@@ -24,6 +28,20 @@ set(FILES
     Source/Render/TuRmlParentPass.cpp
     Source/Render/TuRmlChildPass.h
     Source/Render/TuRmlChildPass.cpp
+    Source/Render/TuRmlContextRenderInterface.h
+    Source/Render/TuRmlContextRenderInterface.cpp
     Source/Render/TuRmlRenderInterface.h
     Source/Render/TuRmlRenderInterface.cpp
+    Source/Render/TuRmlBufferPool.h
+    Source/Render/TuRmlGeometryHeap.h
+    Source/Render/TuRmlGeometryHeap.cpp
+    Source/Render/TuRmlPipelineStateCache.h
+    Source/Render/TuRmlPipelineStateCache.cpp
+    Source/Render/TuRmlRingBuffer.h
+    Source/Render/TuRmlRingBuffer.cpp
+    Source/Render/TuRmlSlotMap.h
+    Source/Render/TuRmlTextureAtlas.h
+    Source/Render/TuRmlTextureAtlas.cpp
+    Source/Render/TuRmlVertexFormat.h
+    Source/Render/TuRmlVertexFormat.cpp
 )